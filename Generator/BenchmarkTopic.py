@@ -0,0 +1,82 @@
+import argparse
+import json
+import os
+import subprocess
+
+GENERATOR_DIR = os.path.dirname(os.path.abspath(__file__))
+RUNNER = os.path.join(GENERATOR_DIR, 'benchmark_runner.js')
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Time the startup of every built example of a topic under node.',
+                                     epilog='Examples must have been built in <topic_path>/<example>/build.')
+    parser.add_argument('topic_path')
+    parser.add_argument('--data', default='packaged_data', help='Directory holding the file_packager outputs.')
+    parser.add_argument('--lazy', action='store_true', help='Load data through the lazy manifests instead of the preload packages.')
+    parser.add_argument('--shared', action='store_true', help='Load data through the shared chunk store manifests.')
+    parser.add_argument('--timeout', type=int, default=120, help='Seconds before a run is abandoned.')
+    parser.add_argument('--output', default=None, help='JSON report, defaults to <topic_path>/benchmark.json.')
+    args = parser.parse_args()
+    data_mode = 'shared' if args.shared else 'lazy' if args.lazy else 'preload'
+    return args.topic_path, args.data, data_mode, args.timeout, args.output
+
+def LoadArgsNeeded():
+    """
+    :return: The arguments and data files of the examples, from ArgsNeeded.json.
+    """
+    with open(os.path.join(GENERATOR_DIR, 'ArgsNeeded.json')) as f:
+        return json.load(f)
+
+def RunExample(js_file, timeout, data_files=None, arguments=None, lazy_manifests=None):
+    """
+    Run one example through benchmark_runner.js.
+
+    :return: The runner report, with 'status' set to the failure reason if it did not finish.
+    """
+    command = ['node', RUNNER, js_file]
+    for data_file in data_files or []:
+        command.extend(['--data', data_file])
+    for manifest in lazy_manifests or []:
+        command.extend(['--lazy', manifest])
+    command.append('--')
+    command.extend(arguments or [])
+    env = dict(os.environ, VTK_WASM_BENCHMARK_TIMEOUT=str(timeout * 1000))
+    try:
+        process = subprocess.run(command, timeout=timeout + 10, env=env,
+                                 stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    except subprocess.TimeoutExpired:
+        return {'status': 'timeout'}
+    for line in process.stdout.decode('utf-8', 'replace').split('\n'):
+        if line.startswith('BENCHMARK '):
+            return json.loads(line[len('BENCHMARK '):])
+    return {'status': 'crashed', 'error': process.stderr.decode('utf-8', 'replace').strip()[-500:]}
+
+def main():
+    topic_path, data_path, data_mode, timeout, output = GetParameters()
+    args_needed = LoadArgsNeeded()
+
+    reports = []
+    for example_name in sorted(os.listdir(topic_path)):
+        js_file = os.path.join(topic_path, example_name, 'build', example_name + '.js')
+        if not os.path.isfile(js_file):
+            continue
+        args_data = args_needed.get(example_name, {})
+        if data_mode != 'preload':
+            if data_mode == 'shared':
+                manifests = [os.path.join(data_path, 'manifests', example_name + '.json')] if args_data.get('files') else []
+            else:
+                manifests = [os.path.join(data_path, f + '.manifest.json') for f in args_data.get('files', [])]
+            report = RunExample(js_file, timeout, arguments=args_data.get('args', []), lazy_manifests=manifests)
+        else:
+            data_files = [os.path.join(data_path, f + '.js') for f in args_data.get('files', [])]
+            report = RunExample(js_file, timeout, data_files, args_data.get('args', []))
+        report['example'] = example_name
+        print('{:40} {}'.format(example_name, report['status']))
+        reports.append(report)
+
+    if output is None:
+        output = os.path.join(topic_path, 'benchmark.json')
+    with open(output, 'w') as f:
+        json.dump({'topic': os.path.basename(os.path.normpath(topic_path)), 'examples': reports}, f, indent=4)
+
+if __name__ == '__main__':
+    main()
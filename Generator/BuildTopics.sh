@@ -0,0 +1,62 @@
+#!/bin/bash
+
+if [ $# -lt 1 ]
+then
+    echo "Usage: ./BuildTopics.sh <topic_dir>... [-- <cmake_options>]"
+    exit 1
+fi
+
+generator_dir=$(dirname $(realpath $0))
+
+topics=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]
+do
+    topics="${topics};$(realpath $1)"
+    shift
+done
+if [ "$1" == "--" ]
+then
+    shift
+fi
+
+# All topics share one configure and one ninja graph: unchanged examples are
+# not rebuilt and compiled objects are reused through ccache.
+# VTK is found from the VTK_DIR environment variable, or from the cmake options.
+build_dir=${SUPERBUILD_DIR:-superbuild}
+vtk_dir_option=""
+if [ -n "${VTK_DIR}" ]
+then
+    vtk_dir_option="-DVTK_DIR=${VTK_DIR}"
+fi
+cmake -GNinja -S ${generator_dir}/Superbuild -B ${build_dir} \
+    -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TOOLCHAIN_FILE} \
+    ${vtk_dir_option} \
+    -DCMAKE_BUILD_TYPE=Release \
+    "-DTOPICS=${topics#;}" \
+    "$@"
+if [ $? -ne 0 ]
+then
+    exit 1
+fi
+
+cmake --build ${build_dir} --parallel ${JOBS:-$(nproc)} -- -k 0
+if [ $? -eq 0 ]
+then
+    exit 0
+fi
+
+# An example whose target is still out of date after the build failed, even
+# if a .wasm of an earlier build is left in its directory.
+for topic in ${topics//;/ }
+do
+    for example in ${topic}/*/
+    do
+        name=$(basename ${example})
+        if [ -f ${example}/CMakeLists.txt ] && \
+            ! cmake --build ${build_dir} --target ${name} -- -n 2>&1 | grep -q "no work to do"
+        then
+            echo ${name} >> doesntcompile.txt
+        fi
+    done
+done
+exit 1
@@ -1,14 +1,15 @@
 #!/bin/bash
 
-if [ $# != 3 ]
+if [ $# -lt 3 ]
 then
-    echo "Usage: ./GenerateExamplesWASM.sh <vtk_source_dir> <source_dir> <target_dir>"
+    echo "Usage: ./GenerateExamplesWASM.sh <vtk_source_dir> <source_dir> <target_dir> [--simd-variant] [--lazy-data] [--shared-data]"
     exit 1
 fi
 
 vtk_source_dir=$1
 source_dir=$2
 target_dir=$3
+shift 3
 
 shopt -s extglob
 
@@ -25,6 +26,6 @@ do
         do
             cp ${addon_file} ${target_path}
         done
-        python3 GenerateHtmlCMake.py ${f} ${target_path} ${vtk_source_dir}
+        python3 GenerateHtmlCMake.py ${f} ${target_path} ${vtk_source_dir} "$@"
     fi
 done
@@ -6,15 +6,31 @@ import subprocess
 import os
 import errno
 
+# Files every generated example needs next to its CMakeLists.txt
+SUPPORT_FILES = ['vtk_threads.pre.js', 'coi-serviceworker.js', 'lazy_data.pre.js', 'compress_artifacts.js', 'vtk_example_entry.h']
+
+DATA_URL = 'https://vtk-wasm-examples.s3.fr-par.scw.cloud/data/'
+
 def GetParameters():
     parser = argparse.ArgumentParser(description='', epilog='')
     parser.add_argument('source_path')
     parser.add_argument('dest_path')
     parser.add_argument('vtk_source_path')
+    parser.add_argument('--simd-variant', action='store_true',
+                        help='Also build a XXX_simd target next to the scalar one.')
+    parser.add_argument('--lazy-data', action='store_true',
+                        help='Fetch data files with range requests instead of preloading them.')
+    parser.add_argument('--shared-data', action='store_true',
+                        help='Fetch data files from the shared content-addressed chunk store.')
     args = parser.parse_args()
-    return args.source_path, args.dest_path, args.vtk_source_path
+    data_mode = 'shared' if args.shared_data else 'lazy' if args.lazy_data else 'preload'
+    return args.source_path, args.dest_path, args.vtk_source_path, args.simd_variant, data_mode
 
-def GenerateExample(example_name, source_path, dest_path, vtk_source_path):
+def CopySupportFiles(dest_path):
+    for support_file in SUPPORT_FILES:
+        shutil.copyfile(support_file, os.path.join(dest_path, support_file))
+
+def GenerateExample(example_name, source_path, dest_path, vtk_source_path, simd_variant):
     shutil.copyfile('index.html.template', os.path.join(dest_path, 'index.html'))
     with open(os.path.join(dest_path, 'index.html'), 'r') as index:
         data = index.read()
@@ -25,6 +41,7 @@ def GenerateExample(example_name, source_path, dest_path, vtk_source_path):
     with open(os.path.join(dest_path, 'CMakeLists.txt'), 'r') as cmake:
         data = cmake.read()
     data = data.replace('XXX', example_name)
+    data = data.replace('SSS', 'ON' if simd_variant else 'OFF')
     try:
         process = subprocess.run('python3 WhatModulesVTK.py ' + vtk_source_path + ' ' + source_path, shell=True, check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         result = process.stdout.decode('utf-8')
@@ -46,8 +63,9 @@ def GenerateExample(example_name, source_path, dest_path, vtk_source_path):
     data = data.replace('ZZZ', result)
     with open(os.path.join(dest_path, 'CMakeLists.txt'), 'w') as cmake:
         cmake.write(data)
+    CopySupportFiles(dest_path)
 
-def GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, args_data):
+def GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, args_data, simd_variant, data_mode):
     shutil.copyfile('index_arguments.html.template', os.path.join(dest_path, 'index.html'))
     with open(os.path.join(dest_path, 'index.html'), 'r') as index:
         data = index.read()
@@ -58,8 +76,16 @@ def GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, a
     data = data.replace('YYY', '\', \''.join(module_arguments))
 
     script_lines = []
-    for file in args_data.get('files'):
-        script_lines.append('<script type="text/javascript" src="https://vtk-wasm-examples.s3.fr-par.scw.cloud/data/' + file + '.js"></script>')
+    data_files = args_data.get('files', [])
+    if data_files and data_mode != 'preload':
+        if data_mode == 'shared':
+            manifests = [DATA_URL + 'manifests/' + example_name + '.json']
+        else:
+            manifests = [DATA_URL + file + '.manifest.json' for file in data_files]
+        script_lines.append('<script type="text/javascript">Module[\'lazyDataManifests\'] = [\'' + '\', \''.join(manifests) + '\'];</script>')
+    else:
+        for file in data_files:
+            script_lines.append('<script type="text/javascript" src="' + DATA_URL + file + '.js"></script>')
     data = data.replace('ZZZ', '\n'.join(script_lines))
 
     with open(os.path.join(dest_path, 'index.html'), 'w') as index:
@@ -68,6 +94,8 @@ def GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, a
     with open(os.path.join(dest_path, 'CMakeLists.txt'), 'r') as cmake:
         data = cmake.read()
     data = data.replace('XXX', example_name)
+    data = data.replace('SSS', 'ON' if simd_variant else 'OFF')
+    data = data.replace('DDD', 'ON' if data_files and data_mode != 'preload' else 'OFF')
     try:
         process = subprocess.run('python3 WhatModulesVTK.py ' + vtk_source_path + ' ' + source_path, shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         result = process.stdout.decode('utf-8')
@@ -90,19 +118,20 @@ def GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, a
 
     with open(os.path.join(dest_path, 'CMakeLists.txt'), 'w') as cmake:
         cmake.write(data)
+    CopySupportFiles(dest_path)
 
 
 def main():
-    source_path, dest_path, vtk_source_path = GetParameters()
+    source_path, dest_path, vtk_source_path, simd_variant, data_mode = GetParameters()
     example_name = os.path.splitext(os.path.basename(source_path))[0]
     with open('ArgsNeeded.json') as f:
         data = json.load(f)
     if data.get(example_name, None):
         print('arguments found')
-        GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, data.get(example_name))
+        GenerateExampleArgs(example_name, source_path, dest_path, vtk_source_path, data.get(example_name), simd_variant, data_mode)
     else:
         print('no arguments found')
-        GenerateExample(example_name, source_path, dest_path, vtk_source_path)
+        GenerateExample(example_name, source_path, dest_path, vtk_source_path, simd_variant)
 
 if __name__ == '__main__':
     main()
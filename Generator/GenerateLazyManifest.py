@@ -0,0 +1,45 @@
+import argparse
+import json
+import os
+import shutil
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Write the manifest and raw files of a lazily loaded data package.',
+                                     epilog='Files are mounted the way "file_packager --preload <data_path>@/" mounts them.')
+    parser.add_argument('data_path')
+    parser.add_argument('output_path')
+    args = parser.parse_args()
+    return args.data_path, args.output_path
+
+def ListFiles(data_path):
+    """
+    :return: (path in the virtual filesystem, path on disk) of every file of the package.
+    """
+    if os.path.isfile(data_path):
+        return [('/' + os.path.basename(data_path), data_path)]
+    files = []
+    for root, dirs, names in os.walk(data_path):
+        dirs.sort()
+        for name in sorted(names):
+            disk_path = os.path.join(root, name)
+            files.append(('/' + os.path.relpath(disk_path, data_path).replace(os.sep, '/'), disk_path))
+    return files
+
+def main():
+    data_path, output_path = GetParameters()
+    package_name = os.path.basename(os.path.normpath(data_path))
+    raw_path = os.path.join(output_path, 'lazy', package_name)
+
+    entries = []
+    for fs_path, disk_path in ListFiles(data_path):
+        url = 'lazy/' + package_name + fs_path
+        raw_file = os.path.join(output_path, url)
+        os.makedirs(os.path.dirname(raw_file), exist_ok=True)
+        shutil.copyfile(disk_path, raw_file)
+        entries.append({'path': fs_path, 'size': os.path.getsize(disk_path), 'url': url})
+
+    with open(os.path.join(output_path, package_name + '.manifest.json'), 'w') as f:
+        json.dump({'package': package_name, 'files': entries}, f, indent=4)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,74 @@
+import argparse
+import hashlib
+import json
+import os
+
+from GenerateLazyManifest import ListFiles
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Split the data of every example of ArgsNeeded.json into a shared content-addressed chunk store.',
+                                     epilog='Writes <output_path>/chunks/<sha256> and <output_path>/manifests/<example>.json.')
+    parser.add_argument('data_path')
+    parser.add_argument('output_path')
+    parser.add_argument('--chunk-size', type=int, default=1024 * 1024, help='Chunk size in bytes.')
+    args = parser.parse_args()
+    return args.data_path, args.output_path, args.chunk_size
+
+def StoreFile(disk_path, chunks_path, chunk_size, stats):
+    """
+    Split a file into chunks named after their content, writing the ones not already stored.
+
+    :return: The chunk hashes, in file order.
+    """
+    hashes = []
+    with open(disk_path, 'rb') as f:
+        while True:
+            chunk = f.read(chunk_size)
+            if not chunk:
+                break
+            digest = hashlib.sha256(chunk).hexdigest()
+            hashes.append(digest)
+            stats['referenced_bytes'] += len(chunk)
+            chunk_file = os.path.join(chunks_path, digest)
+            if not os.path.exists(chunk_file):
+                with open(chunk_file, 'wb') as out:
+                    out.write(chunk)
+                stats['stored_bytes'] += len(chunk)
+    return hashes
+
+def main():
+    data_path, output_path, chunk_size = GetParameters()
+    chunks_path = os.path.join(output_path, 'chunks')
+    manifests_path = os.path.join(output_path, 'manifests')
+    os.makedirs(chunks_path, exist_ok=True)
+    os.makedirs(manifests_path, exist_ok=True)
+
+    with open('ArgsNeeded.json') as f:
+        args_needed = json.load(f)
+
+    # Chunks already in the store from a previous run are not counted as stored.
+    stats = {'referenced_bytes': 0, 'stored_bytes': 0}
+    hashed = {}
+    for example_name, args_data in sorted(args_needed.items()):
+        entries = []
+        for package in args_data.get('files', []):
+            for fs_path, disk_path in ListFiles(os.path.join(data_path, package)):
+                if disk_path not in hashed:
+                    hashed[disk_path] = StoreFile(disk_path, chunks_path, chunk_size, stats)
+                entries.append({'path': fs_path,
+                                 'size': os.path.getsize(disk_path),
+                                 'chunk_size': chunk_size,
+                                 'chunk_url': '../chunks/',
+                                 'chunks': hashed[disk_path]})
+        with open(os.path.join(manifests_path, example_name + '.json'), 'w') as f:
+            json.dump({'example': example_name, 'files': entries}, f, indent=4)
+
+    downloads = 0
+    for example_name, args_data in args_needed.items():
+        for package in args_data.get('files', []):
+            downloads += sum(os.path.getsize(p) for _, p in ListFiles(os.path.join(data_path, package)))
+    print('Per-example downloads: {} bytes'.format(downloads))
+    print('Unique files: {} bytes, new chunks: {} bytes'.format(stats['referenced_bytes'], stats['stored_bytes']))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,59 @@
+import argparse
+import json
+import os
+import re
+
+from WhatModulesVTK import generate_minimal_find_package
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Run the WhatModulesVTK.py symbol analysis on every built example of a topic.',
+                                     epilog='Examples must have been built in <topic_path>/<example>/build.')
+    parser.add_argument('vtk_source_path')
+    parser.add_argument('vtk_lib_dir', help='Folder of the VTK static libraries.')
+    parser.add_argument('topic_path')
+    parser.add_argument('--nm', default='llvm-nm', help='nm program able to read wasm objects.')
+    parser.add_argument('--apply', action='store_true', help='Replace the find_package() of the examples CMakeLists.txt.')
+    args = parser.parse_args()
+    return args.vtk_source_path, args.vtk_lib_dir, args.topic_path, args.nm, args.apply
+
+def FindObjectFile(example_path, example_name):
+    """
+    :return: The compiled example, XXX_objects holds it with RUNTIME=SHARED, or None if it is not built.
+    """
+    for target in (example_name, example_name + '_objects'):
+        object_file = os.path.join(example_path, 'build', 'CMakeFiles', target + '.dir', example_name + '.cxx.o')
+        if os.path.isfile(object_file):
+            return object_file
+    return None
+
+def ApplyFindPackage(cmake_path, find_package):
+    with open(cmake_path, 'r') as cmake:
+        data = cmake.read()
+    data = re.sub(r'(# Symbol analysis[^\n]*\n# Estimated size delta[^\n]*\n)?find_package\(VTK.*?REQUIRED\)',
+                  lambda m: find_package, data, count=1, flags=re.DOTALL)
+    with open(cmake_path, 'w') as cmake:
+        cmake.write(data)
+
+def main():
+    vtk_source_path, vtk_lib_dir, topic_path, nm, apply = GetParameters()
+    reports = []
+    for example_name in sorted(os.listdir(topic_path)):
+        example_path = os.path.join(topic_path, example_name)
+        object_file = FindObjectFile(example_path, example_name)
+        if object_file is None:
+            continue
+        res, report = generate_minimal_find_package(vtk_source_path, [os.path.join(example_path, example_name + '.cxx')],
+                                                    object_file, vtk_lib_dir, nm)
+        if report is None:
+            continue
+        report['example'] = example_name
+        reports.append(report)
+        print('{:40} {:>12} bytes  dropped: {}'.format(example_name, report['size_delta_bytes'], ', '.join(report['dropped'])))
+        if apply:
+            ApplyFindPackage(os.path.join(example_path, 'CMakeLists.txt'), '\n'.join(res))
+
+    with open(os.path.join(topic_path, 'modules_report.json'), 'w') as f:
+        json.dump(reports, f, indent=4)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,20 @@
+#include <dlfcn.h>
+
+#include <cstdlib>
+#include <iostream>
+
+// Main module of the shared VTK runtime. The example is a side module listed
+// in Module.dynamicLibraries, loaded before main() runs; see vtk_example_entry.h.
+int main(int argc, char* argv[])
+{
+  using EntryPoint = int (*)(int, char**);
+  auto entry =
+      reinterpret_cast<EntryPoint>(dlsym(RTLD_DEFAULT, "vtk_example_main"));
+  if (!entry)
+  {
+    std::cerr << "No example side module was loaded: " << dlerror()
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  return entry(argc, argv);
+}
@@ -0,0 +1,53 @@
+import argparse
+import gzip
+import json
+import os
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Compare static builds of the examples of a topic with side modules of the shared VTK runtime.',
+                                     epilog='Examples must have been built in <example>/build with RUNTIME=STATIC and in <example>/build_shared with RUNTIME=SHARED.')
+    parser.add_argument('topic_path')
+    parser.add_argument('runtime_path', help='Build directory of Generator/Runtime.')
+    parser.add_argument('--output', default=None, help='JSON report, defaults to <topic_path>/runtime_report.json.')
+    args = parser.parse_args()
+    return args.topic_path, args.runtime_path, args.output
+
+def TransferSizes(path):
+    with open(path, 'rb') as f:
+        content = f.read()
+    return len(content), len(gzip.compress(content, 9))
+
+def main():
+    topic_path, runtime_path, output = GetParameters()
+    runtime_bytes, runtime_gzip_bytes = TransferSizes(os.path.join(runtime_path, 'vtkruntime.wasm'))
+
+    reports = []
+    for example_name in sorted(os.listdir(topic_path)):
+        static_wasm = os.path.join(topic_path, example_name, 'build', example_name + '.wasm')
+        side_wasm = os.path.join(topic_path, example_name, 'build_shared', example_name + '.wasm')
+        if not os.path.isfile(static_wasm) or not os.path.isfile(side_wasm):
+            continue
+        report = {'example': example_name}
+        report['static_bytes'], report['static_gzip_bytes'] = TransferSizes(static_wasm)
+        report['side_bytes'], report['side_gzip_bytes'] = TransferSizes(side_wasm)
+        reports.append(report)
+        print('{:40} {:>10} -> {:>10} gzip bytes'.format(example_name, report['static_gzip_bytes'], report['side_gzip_bytes']))
+
+    # Visiting every example once: the runtime is fetched on the first visit,
+    # then served from the browser cache.
+    summary = {
+        'examples': len(reports),
+        'runtime_bytes': runtime_bytes,
+        'runtime_gzip_bytes': runtime_gzip_bytes,
+        'static_gzip_bytes': sum(r['static_gzip_bytes'] for r in reports),
+        'shared_gzip_bytes': runtime_gzip_bytes + sum(r['side_gzip_bytes'] for r in reports),
+    }
+    print('static {static_gzip_bytes} gzip bytes, shared runtime {shared_gzip_bytes} gzip bytes for {examples} examples'.format(**summary))
+
+    if output is None:
+        output = os.path.join(topic_path, 'runtime_report.json')
+    with open(output, 'w') as f:
+        json.dump({'summary': summary, 'examples': reports}, f, indent=4)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,67 @@
+import argparse
+import json
+import os
+import statistics
+
+from BenchmarkTopic import LoadArgsNeeded, RunExample
+
+def GetParameters():
+    parser = argparse.ArgumentParser(description='Compare scalar and SIMD builds of the examples of a topic.',
+                                     epilog='Examples must have been generated with --simd-variant and built in <example>/build.')
+    parser.add_argument('topic_path')
+    parser.add_argument('--data', default='packaged_data', help='Directory holding the file_packager outputs.')
+    parser.add_argument('--runs', type=int, default=5, help='Number of timed runs per build.')
+    parser.add_argument('--timeout', type=int, default=120, help='Seconds before a run is abandoned.')
+    parser.add_argument('--output', default=None, help='JSON report, defaults to <topic_path>/simd_report.json.')
+    args = parser.parse_args()
+    return args.topic_path, args.data, args.runs, args.timeout, args.output
+
+def TimeRun(build_dir, js_file, runs, timeout, data_files, arguments):
+    timings = []
+    for _ in range(runs):
+        report = RunExample(os.path.join(build_dir, js_file), timeout, data_files, arguments)
+        if report['status'] not in ('exited', 'rendered'):
+            return None, report.get('error', report['status'])
+        timings.append(report['total_ms'] / 1000.0)
+    return statistics.median(timings), None
+
+def ReportExample(example_name, build_dir, runs, timeout, data_files, arguments):
+    report = {'example': example_name}
+    for variant, name in (('scalar', example_name), ('simd', example_name + '_simd')):
+        wasm_file = os.path.join(build_dir, name + '.wasm')
+        report[variant + '_wasm_bytes'] = os.path.getsize(wasm_file)
+        seconds, error = TimeRun(build_dir, name + '.js', runs, timeout, data_files, arguments)
+        report[variant + '_seconds'] = seconds
+        if error:
+            report[variant + '_error'] = error
+    if report['scalar_seconds'] and report['simd_seconds']:
+        report['speedup'] = report['scalar_seconds'] / report['simd_seconds']
+    return report
+
+def main():
+    topic_path, data_path, runs, timeout, output = GetParameters()
+    args_needed = LoadArgsNeeded()
+    reports = []
+    for example_name in sorted(os.listdir(topic_path)):
+        build_dir = os.path.join(topic_path, example_name, 'build')
+        if not os.path.isfile(os.path.join(build_dir, example_name + '_simd.wasm')):
+            continue
+        print(example_name)
+        args_data = args_needed.get(example_name, {})
+        data_files = [os.path.join(data_path, f + '.js') for f in args_data.get('files', [])]
+        reports.append(ReportExample(example_name, build_dir, runs, timeout,
+                                     data_files, args_data.get('args', [])))
+
+    for report in sorted(reports, key=lambda r: r.get('speedup', 0.0), reverse=True):
+        if 'speedup' in report:
+            print('{:40} {:6.2f}x'.format(report['example'], report['speedup']))
+        else:
+            print('{:40} {}'.format(report['example'], report.get('scalar_error') or report.get('simd_error')))
+
+    if output is None:
+        output = os.path.join(topic_path, 'simd_report.json')
+    with open(output, 'w') as f:
+        json.dump(reports, f, indent=4)
+
+if __name__ == '__main__':
+    main()
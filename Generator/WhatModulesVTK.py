@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 
 import re
+import subprocess
 import sys
 from collections import defaultdict
 from pathlib import Path
@@ -30,13 +31,24 @@ Note:
 2) If linking fails, it usually means that the needed module has not been
      built, so you may need to add it to your VTK build and rebuild VTK.
 3) More modules than strictly necessary may be included.     
+4) With --symbols, the undefined symbols of the compiled application are
+     resolved against the VTK static libraries, and the implementation
+     modules (RenderingOpenGL2, RenderingFreeType, IOExportPDF, ...) are only
+     kept when one of their object factory overrides is reachable.
     '''
     parser = argparse.ArgumentParser(description=description, epilog=epilogue,
                                      formatter_class=argparse.RawDescriptionHelpFormatter)
     parser.add_argument('vtk_path', help='The path to the VTK source tree.')
     parser.add_argument('application', nargs='+', help='Paths to the application files or folders.')
+    parser.add_argument('--symbols', metavar='OBJECT_FILE',
+                        help='Compiled object of the application: only keep the implementation modules'
+                             ' (RenderingOpenGL2, RenderingFreeType, ...) its undefined symbols actually need.')
+    parser.add_argument('--vtk-lib-dir', help='Folder of the VTK static libraries, required by --symbols.')
+    parser.add_argument('--nm', default='llvm-nm', help='nm program able to read the objects, default: llvm-nm.')
     args = parser.parse_args()
-    return args.vtk_path, args.application
+    if args.symbols and not args.vtk_lib_dir:
+        parser.error('--symbols requires --vtk-lib-dir')
+    return args.vtk_path, args.application, args.symbols, args.vtk_lib_dir, args.nm
 
 
 def check_paths(vtk_src_dir, application_srcs):
@@ -65,6 +77,24 @@ def check_paths(vtk_src_dir, application_srcs):
     return ok
 
 
+def list_module_keyword(args, keyword):
+    """
+    Read the values of a list keyword of a vtk.module file.
+
+    :param args: The lines of the vtk.module file.
+    :param keyword: The keyword, e.g. IMPLEMENTS.
+    :return: The values, indented on the lines following the keyword.
+    """
+    values = list()
+    if keyword in args:
+        for line in args[args.index(keyword) + 1:]:
+            if not line[:1].isspace():
+                break
+            if line.strip():
+                values.append(line.strip())
+    return values
+
+
 def find_vtk_modules(vtk_src_dir):
     """
     Build a dict of the VTK Module name, library name(if it exists) and any header files.
@@ -95,6 +125,8 @@ def find_vtk_modules(vtk_src_dir):
                     headers.extend([f.name for f in module.parent.glob(pattern)])
             vtk_modules[name]['library_name'] = library_name
             vtk_modules[name]['headers'] = headers
+            vtk_modules[name]['implements'] = list_module_keyword(args, 'IMPLEMENTS')
+            vtk_modules[name]['path'] = module.parent
     return vtk_modules
 
 
@@ -132,19 +164,14 @@ def find_application_includes(path):
     return includes
 
 
-def generate_find_package(vtk_src_dir, application_srcs):
+def find_header_modules(vtk_modules, application_srcs):
     """
-    Generate the find_package statement.
-    
-    :param vtk_src_dir: The VTK source folder.
+    Find the modules providing the VTK headers included by the application.
+
+    :param vtk_modules: The modules, see find_vtk_modules().
     :param application_srcs: A list of application folders and or files.
-    :return: The find_package statement.
+    :return: The modules, None if no VTK include was found.
     """
-    vtk_modules = find_vtk_modules(vtk_src_dir)
-    # Test to see if VTK source is provided
-    if len(vtk_modules) == 0:
-        print(vtk_src_dir, 'is not a VTK source directory. It does not contain any vtk.module files.')
-        return None
     vtk_headers_modules = build_headers_modules(vtk_modules)
 
     valid_extensions = ['.h', '.hxx', '.txx', '.cpp', '.cxx', '.cc']
@@ -172,7 +199,15 @@ def generate_find_package(vtk_src_dir, application_srcs):
         if inc in vtk_headers_modules:
             for m in vtk_headers_modules[inc]:
                 all_modules.add(m)
+    return all_modules
+
 
+def add_implementation_modules(all_modules):
+    """
+    Add the modules implementing the object factory overrides that are usually needed.
+
+    :param all_modules: The modules found from the headers, modified in place.
+    """
     if 'VTK::RenderingCore' in all_modules:
         all_modules.add('VTK::RenderingOpenGL2')
         all_modules.add('VTK::InteractionStyle')
@@ -190,6 +225,8 @@ def generate_find_package(vtk_src_dir, application_srcs):
         all_modules.add('VTK::IOExportPDF')
         all_modules.add('VTK::RenderingContextOpenGL2')
 
+
+def format_find_package(all_modules):
     res = ['find_package(VTK', ' COMPONENTS']
     for m in sorted(all_modules):
         m = remove_prefix(m, 'VTK::')
@@ -198,12 +235,238 @@ def generate_find_package(vtk_src_dir, application_srcs):
     return res
 
 
+def generate_find_package(vtk_src_dir, application_srcs):
+    """
+    Generate the find_package statement.
+    
+    :param vtk_src_dir: The VTK source folder.
+    :param application_srcs: A list of application folders and or files.
+    :return: The find_package statement.
+    """
+    vtk_modules = find_vtk_modules(vtk_src_dir)
+    # Test to see if VTK source is provided
+    if len(vtk_modules) == 0:
+        print(vtk_src_dir, 'is not a VTK source directory. It does not contain any vtk.module files.')
+        return None
+    all_modules = find_header_modules(vtk_modules, application_srcs)
+    if all_modules is None:
+        return None
+    add_implementation_modules(all_modules)
+    return format_find_package(all_modules)
+
+
+def find_factory_overrides(vtk_modules):
+    """
+    Find the classes each module overrides through its object factory.
+
+    Reads the vtk_object_factory_declare() calls of the module CMakeLists.txt,
+    expanding the foreach() loops over set()/list(APPEND) lists they usually live in.
+
+    :param vtk_modules: The modules, see find_vtk_modules().
+    :return: The overridden base classes per module, None for a module whose overrides
+             could not be resolved.
+    """
+    declare = re.compile(r'vtk_object_factory_declare\s*\(\s*BASE\s+"?([^\s")]+)"?\s+OVERRIDE')
+    overrides = dict()
+    for name, module in vtk_modules.items():
+        cmake = module['path'] / 'CMakeLists.txt'
+        if not cmake.is_file():
+            continue
+        content = re.sub(r'#[^\n]*', '', cmake.read_text())
+        if 'vtk_object_factory_declare' not in content:
+            continue
+        lists = defaultdict(list)
+        for var, items in re.findall(r'\bset\s*\(\s*(\w+)\s+([^)]*)\)', content):
+            lists[var] = items.replace('"', '').split()
+        for var, items in re.findall(r'\blist\s*\(\s*APPEND\s+(\w+)\s+([^)]*)\)', content):
+            lists[var].extend(items.replace('"', '').split())
+        bases = set()
+        loops = re.compile(r'\bforeach\s*\(\s*(\w+)\s+IN\s+(LISTS|ITEMS)\s+([^)]*)\)(.*?)\bendforeach', re.DOTALL)
+        for var, kind, items, body in loops.findall(content):
+            values = items.split() if kind == 'ITEMS' else [v for l in items.split() for v in lists[l]]
+            for base in declare.findall(body):
+                bases.update(base.replace('${' + var + '}', v) for v in values)
+        bases.update(declare.findall(loops.sub('', content)))
+        overrides[name] = None if any('$' in b for b in bases) else bases
+    return overrides
+
+
+def read_archive_member_sizes(path):
+    """
+    Read the size of the members of a static library (ar format).
+
+    :param path: The library.
+    :return: The member sizes, by member name.
+    """
+    sizes = dict()
+    data = Path(path).read_bytes()
+    if not data.startswith(b'!<arch>\n'):
+        return sizes
+    long_names = b''
+    offset = 8
+    while offset + 60 <= len(data):
+        header = data[offset:offset + 60]
+        name = header[:16].decode('ascii', 'replace').strip()
+        size = int(header[48:58].decode('ascii').strip())
+        if name == '//':
+            long_names = data[offset + 60:offset + 60 + size]
+        elif name.startswith('/') and name[1:].isdigit():
+            start = int(name[1:])
+            name = long_names[start:long_names.index(b'\n', start)].decode('ascii', 'replace').rstrip('/')
+        elif name.startswith('#1/'):
+            # BSD long name, stored at the start of the member
+            name_length = int(name[3:])
+            name = data[offset + 60:offset + 60 + name_length].decode('ascii', 'replace').rstrip('\0')
+            size -= name_length
+        else:
+            name = name.rstrip('/')
+        if name and name != '/':
+            sizes[name] = size
+        offset += 60 + size + size % 2
+    return sizes
+
+
+def read_symbols(nm, paths):
+    """
+    Read the symbol tables of objects and static libraries.
+
+    :param nm: The nm program.
+    :param paths: The object files and libraries.
+    :return: Where each symbol is defined, and the undefined symbols of each object,
+             objects being (file, archive member or None) pairs.
+    """
+    line_re = re.compile(r'^(.+?):(?:([^:]+):)?\s*(?:[0-9a-fA-F]+\s+)?([A-Za-z?])\s+(\S+)$')
+    defined = dict()
+    undefined = defaultdict(set)
+    process = subprocess.run([nm, '-A'] + [str(p) for p in paths], check=True,
+                             stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    for line in process.stdout.decode('utf-8', 'replace').split('\n'):
+        match = line_re.match(line.strip())
+        if not match:
+            continue
+        path, member, kind, symbol = match.groups()
+        obj = (path, member)
+        if kind in 'Uvw':
+            undefined[obj].add(symbol)
+        elif kind.isupper():
+            defined.setdefault(symbol, obj)
+    return defined, undefined
+
+
+def resolve_symbols(roots, defined, undefined):
+    """
+    Pull the library members needed by a set of symbols, like a static linker.
+
+    :return: The pulled members and every symbol they reference.
+    """
+    members = set()
+    referenced = set(roots)
+    pending = list(roots)
+    while pending:
+        obj = defined.get(pending.pop())
+        if obj is None or obj in members:
+            continue
+        members.add(obj)
+        for symbol in undefined[obj]:
+            if symbol not in referenced:
+                referenced.add(symbol)
+                pending.append(symbol)
+    return members, referenced
+
+
+def generate_minimal_find_package(vtk_src_dir, application_srcs, object_file, vtk_lib_dir, nm):
+    """
+    Generate a find_package statement only keeping the implementation modules
+    whose object factory overrides are reachable from the compiled application.
+
+    :param vtk_src_dir: The VTK source folder.
+    :param application_srcs: A list of application folders and or files.
+    :param object_file: The compiled application object.
+    :param vtk_lib_dir: The folder of the VTK static libraries.
+    :param nm: The nm program.
+    :return: The find_package statement and a report dict.
+    """
+    vtk_modules = find_vtk_modules(vtk_src_dir)
+    if len(vtk_modules) == 0:
+        print(vtk_src_dir, 'is not a VTK source directory. It does not contain any vtk.module files.')
+        return None, None
+    header_modules = find_header_modules(vtk_modules, application_srcs)
+    if header_modules is None:
+        return None, None
+    all_modules = set(header_modules)
+    add_implementation_modules(all_modules)
+
+    library_modules = dict()
+    for name, module in vtk_modules.items():
+        library_modules[module['library_name'] or 'vtk' + remove_prefix(name, 'VTK::')] = name
+    libraries = dict()
+    for library in Path(vtk_lib_dir).glob('lib*.a'):
+        match = re.match(r'lib(.+?)(-\d+(\.\d+)*)?\.a$', library.name)
+        if match and match.group(1) in library_modules:
+            libraries[str(library)] = library_modules[match.group(1)]
+    defined, undefined = read_symbols(nm, [object_file] + sorted(libraries))
+    # The object was compiled with the heuristic autoinit list, whose constructors would pull
+    # in the very modules under judgement: only the needed ones are added back below.
+    roots = {s for s in undefined[(str(object_file), None)] if '_AutoInit_Construct' not in s}
+
+    def autoinit_symbols(modules):
+        names = [m['library_name'] or 'vtk' + remove_prefix(n, 'VTK::')
+                 for n, m in vtk_modules.items() if n in modules]
+        return {s for s in defined for n in names if n + '_AutoInit_Construct' in s}
+
+    def module_used(name, members):
+        return any(libraries.get(path) == name for path, _ in members)
+
+    overrides = find_factory_overrides(vtk_modules)
+    candidates = all_modules - header_modules
+    needed = set()
+    while True:
+        members, referenced = resolve_symbols(roots | autoinit_symbols(header_modules | needed), defined, undefined)
+        added = set()
+        for name in candidates - needed:
+            bases = overrides.get(name, set())
+            if bases is None:
+                used = any(module_used(m, members) for m in vtk_modules[name]['implements'])
+            else:
+                used = any('_ZN{}{}3NewEv'.format(len(b), b) in referenced for b in bases)
+            if used:
+                added.add(name)
+        if not added:
+            break
+        needed |= added
+
+    minimal_modules = header_modules | needed
+    sizes = dict()
+    for path in libraries:
+        for member, size in read_archive_member_sizes(path).items():
+            sizes[(path, member)] = size
+
+    def linked_size(modules):
+        members, _ = resolve_symbols(roots | autoinit_symbols(modules), defined, undefined)
+        return sum(sizes.get(m, 0) for m in members)
+
+    report = {'object': str(object_file),
+              'components': sorted(remove_prefix(m, 'VTK::') for m in minimal_modules),
+              'dropped': sorted(remove_prefix(m, 'VTK::') for m in all_modules - minimal_modules),
+              'heuristic_bytes': linked_size(all_modules),
+              'minimal_bytes': linked_size(minimal_modules)}
+    report['size_delta_bytes'] = report['minimal_bytes'] - report['heuristic_bytes']
+
+    res = ['# Symbol analysis of ' + Path(object_file).name + ': dropped ' + (', '.join(report['dropped']) or 'nothing'),
+           '# Estimated size delta: {} bytes of library members'.format(report['size_delta_bytes'])]
+    res.extend(format_find_package(minimal_modules))
+    return res, report
+
+
 def main():
-    vtk_src_dir, application_srcs = get_program_parameters()
+    vtk_src_dir, application_srcs, object_file, vtk_lib_dir, nm = get_program_parameters()
     if not check_paths(vtk_src_dir, application_srcs):
         return
 
-    res = generate_find_package(vtk_src_dir, application_srcs)
+    if object_file:
+        res, _ = generate_minimal_find_package(vtk_src_dir, application_srcs, object_file, vtk_lib_dir, nm)
+    else:
+        res = generate_find_package(vtk_src_dir, application_srcs)
     if res:
         print('\n'.join(res))
 
@@ -0,0 +1,240 @@
+// Headless runner used by BenchmarkTopic.py.
+//
+// Usage: node benchmark_runner.js <build_dir>/<example>.js [--data <package>.js] [--lazy <package>.manifest.json]... [-- <arguments>]
+//
+// Loads a built example under node with a stub canvas and a no-op WebGL2
+// context, times the startup phases and prints a single "BENCHMARK {...}" line.
+
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+const { performance } = require('perf_hooks');
+
+const TIMEOUT_MS = Number(process.env.VTK_WASM_BENCHMARK_TIMEOUT || 60000);
+
+function parseArguments(argv) {
+  const options = { script: null, data: [], lazy: [], args: [] };
+  for (let i = 0; i < argv.length; ++i) {
+    if (argv[i] === '--') {
+      options.args = argv.slice(i + 1);
+      break;
+    } else if (argv[i] === '--data') {
+      options.data.push(path.resolve(argv[++i]));
+    } else if (argv[i] === '--lazy') {
+      options.lazy.push(path.resolve(argv[++i]));
+    } else {
+      options.script = path.resolve(argv[i]);
+    }
+  }
+  return options;
+}
+
+const options = parseArguments(process.argv.slice(2));
+if (!options.script) {
+  console.error('Usage: node benchmark_runner.js <example>.js [--data <package>.js] [--lazy <package>.manifest.json]... [-- <arguments>]');
+  process.exit(1);
+}
+
+const buildDir = path.dirname(options.script);
+const exampleName = path.basename(options.script, '.js');
+const report = { example: exampleName };
+const start = performance.now();
+let memory = null;
+let preloadStart = null;
+let mainStart = null;
+let finished = false;
+
+function elapsed(from) {
+  return Math.round((performance.now() - from) * 1000) / 1000;
+}
+
+function finish(status, error) {
+  if (finished) return;
+  finished = true;
+  report.status = status;
+  if (error) report.error = String(error);
+  report.total_ms = elapsed(start);
+  report.peak_heap_bytes = memory ? memory.buffer.byteLength : null;
+  if (options.lazy.length && Module['lazyDataStats']) {
+    report.lazy_requests = Module['lazyDataStats']['requests'];
+    report.lazy_bytes = Module['lazyDataStats']['bytes'];
+  }
+  process.stdout.write('BENCHMARK ' + JSON.stringify(report) + '\n');
+  process.exit(0);
+}
+
+// -----------------------------------------------------------------------------
+// No-render stubs
+// -----------------------------------------------------------------------------
+const GL_PARAMETERS = {
+  0x1f00: 'VTK-WASM benchmark', // VENDOR
+  0x1f01: 'no-op WebGL2', // RENDERER
+  0x1f02: 'WebGL 2.0', // VERSION
+  0x8b8c: 'WebGL GLSL ES 3.00', // SHADING_LANGUAGE_VERSION
+  0x0d33: 4096, // MAX_TEXTURE_SIZE
+  0x0d3a: new Int32Array([4096, 4096]), // MAX_VIEWPORT_DIMS
+  0x0ba2: new Int32Array([0, 0, 300, 150]), // VIEWPORT
+  0x0d52: 8, 0x0d53: 8, 0x0d54: 8, 0x0d55: 8, // RED/GREEN/BLUE/ALPHA_BITS
+  0x0d56: 24, // DEPTH_BITS
+  0x8073: 2048, // MAX_3D_TEXTURE_SIZE
+  0x84e8: 4096, // MAX_RENDERBUFFER_SIZE
+  0x8824: 4, // MAX_DRAW_BUFFERS
+  0x8869: 16, // MAX_VERTEX_ATTRIBS
+  0x8872: 16, // MAX_TEXTURE_IMAGE_UNITS
+  0x88ff: 256, // MAX_ARRAY_TEXTURE_LAYERS
+  0x8b4d: 32, // MAX_COMBINED_TEXTURE_IMAGE_UNITS
+  0x8cdf: 4, // MAX_COLOR_ATTACHMENTS
+};
+
+function noop() {}
+
+function createWebGLStub(canvas, attributes) {
+  const markRender = function () {
+    if (report.main_to_first_render_ms === undefined && mainStart !== null) {
+      report.main_to_first_render_ms = elapsed(mainStart);
+      // Render() is synchronous: report once main() yields back to the event loop.
+      setTimeout(() => finish('rendered'), 0);
+    }
+  };
+  const context = {
+    canvas: canvas,
+    get drawingBufferWidth() { return canvas.width; },
+    get drawingBufferHeight() { return canvas.height; },
+    getContextAttributes: () => attributes || {},
+    isContextLost: () => false,
+    getError: () => 0,
+    getParameter: (pname) => (pname in GL_PARAMETERS ? GL_PARAMETERS[pname] : 0),
+    getSupportedExtensions: () => [],
+    getExtension: () => null,
+    getShaderParameter: (shader, pname) => (pname === 0x8b81 ? true : 0), // COMPILE_STATUS
+    getProgramParameter: (program, pname) => (pname === 0x8b82 || pname === 0x8b83 ? true : 0), // LINK/VALIDATE_STATUS
+    getShaderInfoLog: () => '',
+    getProgramInfoLog: () => '',
+    getUniformLocation: () => ({}),
+    getAttribLocation: () => 0,
+    checkFramebufferStatus: () => 0x8cd5, // FRAMEBUFFER_COMPLETE
+    clear: markRender,
+    drawArrays: markRender,
+    drawElements: markRender,
+    drawArraysInstanced: markRender,
+    drawElementsInstanced: markRender,
+    drawRangeElements: markRender,
+  };
+  return new Proxy(context, {
+    get(target, property) {
+      if (property in target) return target[property];
+      if (typeof property !== 'string' || property === 'then') return undefined;
+      if (property.startsWith('create') || property === 'fenceSync') return () => ({});
+      return noop;
+    },
+  });
+}
+
+function createElementStub(id) {
+  const element = {
+    id: id,
+    width: 300,
+    height: 150,
+    clientWidth: 300,
+    clientHeight: 150,
+    style: {},
+    addEventListener: noop,
+    removeEventListener: noop,
+    setAttribute: noop,
+    focus: noop,
+    getBoundingClientRect: () => ({ left: 0, top: 0, right: element.width, bottom: element.height, width: element.width, height: element.height }),
+    getContext: (type, attributes) => {
+      if (!element.context) element.context = createWebGLStub(element, attributes);
+      return element.context;
+    },
+  };
+  return element;
+}
+
+const canvas = createElementStub('canvas');
+globalThis.document = {
+  body: createElementStub('body'),
+  documentElement: createElementStub('html'),
+  querySelector: () => canvas,
+  getElementById: () => canvas,
+  createElement: (tag) => createElementStub(tag),
+  addEventListener: noop,
+  removeEventListener: noop,
+};
+
+// -----------------------------------------------------------------------------
+// Module configuration
+// -----------------------------------------------------------------------------
+globalThis.Module = {
+  canvas: canvas,
+  arguments: options.args,
+  lazyDataManifests: options.lazy,
+  print: noop,
+  printErr: (text) => {
+    report.last_error = text;
+  },
+  locateFile: (file, prefix) => {
+    const local = path.join(buildDir, file);
+    if (fs.existsSync(local)) return local;
+    const data = options.data.map((p) => path.join(path.dirname(p), file)).find((p) => fs.existsSync(p));
+    return data || prefix + file;
+  },
+  instantiateWasm: (imports, successCallback) => {
+    const bytes = fs.readFileSync(path.join(buildDir, exampleName + '.wasm'));
+    report.wasm_bytes = bytes.length;
+    let t = performance.now();
+    WebAssembly.compile(bytes)
+      .then((module) => {
+        report.compile_ms = elapsed(t);
+        t = performance.now();
+        return WebAssembly.instantiate(module, imports).then((instance) => {
+          report.instantiate_ms = elapsed(t);
+          memory =
+            Object.values(instance.exports).find((e) => e instanceof WebAssembly.Memory) ||
+            Object.values(imports.env || {}).find((e) => e instanceof WebAssembly.Memory);
+          preloadStart = performance.now();
+          successCallback(instance, module);
+        });
+      })
+      .catch((err) => finish('failed', err));
+    return {};
+  },
+  onRuntimeInitialized: () => {
+    mainStart = performance.now();
+    report.preload_ms = elapsed(preloadStart);
+    report.start_to_main_ms = elapsed(start);
+  },
+  postRun: [
+    () => {
+      if (report.main_to_first_render_ms === undefined) {
+        report.main_ms = elapsed(mainStart);
+        finish('exited');
+      }
+    },
+  ],
+  onAbort: (what) => finish('aborted', what),
+  quit: (status, toThrow) => finish(status === 0 ? 'exited' : 'failed', toThrow),
+};
+
+// Emscripten's node code path expects CommonJS globals.
+globalThis.require = require;
+globalThis.__dirname = buildDir;
+globalThis.__filename = options.script;
+
+setTimeout(() => finish('timeout'), TIMEOUT_MS).unref();
+process.on('beforeExit', () => finish(mainStart === null ? 'failed' : 'exited', report.last_error));
+process.on('uncaughtException', (err) => {
+  if (err === 'unwind' || (err && err.name === 'ExitStatus')) return;
+  finish('failed', err && err.stack ? err.stack.split('\n')[0] : err);
+});
+
+try {
+  for (const data of options.data) {
+    vm.runInThisContext(fs.readFileSync(data, 'utf8'), { filename: data });
+  }
+  const source = fs.readFileSync(options.script, 'utf8');
+  report.js_bytes = Buffer.byteLength(source);
+  vm.runInThisContext(source, { filename: options.script });
+} catch (err) {
+  finish('failed', err);
+}
@@ -0,0 +1,46 @@
+// Threaded examples rely on SharedArrayBuffer, which browsers only expose to
+// cross-origin isolated pages. Static hosts (S3, python -m http.server) cannot
+// send the COOP/COEP headers, so this service worker adds them to every
+// response and the page reloads itself once the worker is in control.
+
+if (typeof window === 'undefined') {
+  self.addEventListener('install', () => self.skipWaiting());
+  self.addEventListener('activate', (event) => event.waitUntil(self.clients.claim()));
+
+  self.addEventListener('fetch', function (event) {
+    const request = event.request;
+    if (request.cache === 'only-if-cached' && request.mode !== 'same-origin') {
+      return;
+    }
+    event.respondWith(
+      fetch(request).then(function (response) {
+        if (response.status === 0) {
+          return response;
+        }
+        const headers = new Headers(response.headers);
+        headers.set('Cross-Origin-Embedder-Policy', 'require-corp');
+        headers.set('Cross-Origin-Opener-Policy', 'same-origin');
+        headers.set('Cross-Origin-Resource-Policy', 'cross-origin');
+        return new Response(response.body, {
+          status: response.status,
+          statusText: response.statusText,
+          headers: headers,
+        });
+      })
+    );
+  });
+} else if (!window.crossOriginIsolated && window.isSecureContext && 'serviceWorker' in navigator) {
+  navigator.serviceWorker.register(document.currentScript.src).then(function (registration) {
+    if (registration.active && !navigator.serviceWorker.controller) {
+      window.location.reload();
+    } else {
+      registration.addEventListener('updatefound', function () {
+        registration.installing.addEventListener('statechange', function () {
+          if (this.state === 'activated') window.location.reload();
+        });
+      });
+    }
+  }, function (err) {
+    console.error('Cross-origin isolation service worker failed to register:', err);
+  });
+}
@@ -0,0 +1,45 @@
+// Pre-compress the artifacts of a build directory (or single files) at the
+// highest Brotli and gzip levels, next to the originals as <file>.br and
+// <file>.gz, and print their sizes as JSON.
+//
+// Usage: node compress_artifacts.js <build_dir|file>...
+
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+
+const EXTENSIONS = ['.html', '.js', '.wasm', '.data', '.json'];
+
+function compress(file) {
+  const bytes = fs.readFileSync(file);
+  const brotli = zlib.brotliCompressSync(bytes, {
+    params: {
+      [zlib.constants.BROTLI_PARAM_QUALITY]: zlib.constants.BROTLI_MAX_QUALITY,
+      [zlib.constants.BROTLI_PARAM_LGWIN]: zlib.constants.BROTLI_MAX_WINDOW_BITS,
+      [zlib.constants.BROTLI_PARAM_SIZE_HINT]: bytes.length,
+      [zlib.constants.BROTLI_PARAM_MODE]: file.endsWith('.wasm') || file.endsWith('.data')
+        ? zlib.constants.BROTLI_MODE_GENERIC
+        : zlib.constants.BROTLI_MODE_TEXT,
+    },
+  });
+  const gzip = zlib.gzipSync(bytes, { level: zlib.constants.Z_BEST_COMPRESSION });
+  fs.writeFileSync(file + '.br', brotli);
+  fs.writeFileSync(file + '.gz', gzip);
+  return { file: file, bytes: bytes.length, br_bytes: brotli.length, gz_bytes: gzip.length };
+}
+
+function listArtifacts(target) {
+  if (!fs.statSync(target).isDirectory()) return [target];
+  return fs
+    .readdirSync(target)
+    .filter((name) => EXTENSIONS.includes(path.extname(name)))
+    .map((name) => path.join(target, name));
+}
+
+const targets = process.argv.slice(2);
+if (!targets.length) {
+  console.error('Usage: node compress_artifacts.js <build_dir|file>...');
+  process.exit(1);
+}
+const report = [].concat(...targets.map(listArtifacts)).map(compress);
+process.stdout.write(JSON.stringify(report, null, 2) + '\n');
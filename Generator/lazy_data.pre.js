@@ -0,0 +1,132 @@
+// Included with --pre-js by examples reading packaged data.
+// Mounts every file listed in the manifests of Module['lazyDataManifests']
+// (written by "package_data.sh <emsdk_path> --lazy") as a lazy file: its
+// content is fetched with HTTP range requests, one chunk at a time, the first
+// time a reader touches it. Module['lazyDataStats'] counts what was fetched.
+// Entries of shared manifests (GenerateSharedBundles.py) list content-addressed
+// chunks instead, which are fetched whole so that the browser can cache them.
+
+var vtkLazyChunkSize = Module['lazyDataChunkSize'] || 256 * 1024;
+Module['lazyDataStats'] = { 'requests': 0, 'bytes': 0 };
+
+function vtkLazyResolve(base, url) {
+  if (ENVIRONMENT_IS_NODE) {
+    return require('path').join(require('path').dirname(base), url);
+  }
+  return new URL(url, new URL(base, location.href)).href;
+}
+
+function vtkLazyReadManifest(url, onload) {
+  if (ENVIRONMENT_IS_NODE) {
+    onload(JSON.parse(require('fs').readFileSync(url, 'utf8')));
+    return;
+  }
+  fetch(url).then(function (response) {
+    if (!response.ok) throw new Error(url + ': ' + response.status);
+    return response.json();
+  }).then(onload, function (err) {
+    abort('Cannot load data manifest ' + err);
+  });
+}
+
+// Synchronous on purpose: readers call fread() from the middle of main().
+// Without a range (to === null) the whole resource is fetched.
+function vtkLazyFetchRange(url, from, to) {
+  Module['lazyDataStats']['requests']++;
+  if (ENVIRONMENT_IS_NODE) {
+    var fs = require('fs');
+    var fd = fs.openSync(url, 'r');
+    var bytes = new Uint8Array(to === null ? fs.fstatSync(fd).size : to - from);
+    fs.readSync(fd, bytes, 0, bytes.length, from);
+    fs.closeSync(fd);
+    Module['lazyDataStats']['bytes'] += bytes.length;
+    return { bytes: bytes, whole: false };
+  }
+  var xhr = new XMLHttpRequest();
+  xhr.open('GET', url, false);
+  if (to !== null) {
+    xhr.setRequestHeader('Range', 'bytes=' + from + '-' + (to - 1));
+  }
+  // Binary responseType is not allowed for synchronous requests on the main
+  // thread, read the body as a byte string instead.
+  xhr.overrideMimeType('text/plain; charset=x-user-defined');
+  xhr.send(null);
+  if (xhr.status !== 200 && xhr.status !== 206) {
+    throw new Error('Cannot fetch ' + url + ': ' + xhr.status);
+  }
+  var text = xhr.responseText;
+  var bytes = new Uint8Array(text.length);
+  for (var i = 0; i < text.length; ++i) {
+    bytes[i] = text.charCodeAt(i) & 0xff;
+  }
+  Module['lazyDataStats']['bytes'] += bytes.length;
+  // 200: the server ignored the Range header and sent the whole file.
+  return { bytes: bytes, whole: to !== null && xhr.status === 200 };
+}
+
+function vtkLazyCreateFile(entry, url, manifestUrl) {
+  var path = entry['path'];
+  var size = entry['size'];
+  var chunkSize = entry['chunk_size'] || vtkLazyChunkSize;
+  var chunks = [];
+  var whole = null;
+
+  function getChunk(index) {
+    if (whole) {
+      return whole.subarray(index * chunkSize, (index + 1) * chunkSize);
+    }
+    if (!chunks[index]) {
+      if (entry['chunks']) {
+        var chunkUrl = vtkLazyResolve(manifestUrl, entry['chunk_url'] + entry['chunks'][index]);
+        chunks[index] = vtkLazyFetchRange(chunkUrl, 0, null).bytes;
+        return chunks[index];
+      }
+      var from = index * chunkSize;
+      var result = vtkLazyFetchRange(url, from, Math.min(size, from + chunkSize));
+      if (result.whole) {
+        whole = result.bytes;
+        return getChunk(index);
+      }
+      chunks[index] = result.bytes;
+    }
+    return chunks[index];
+  }
+
+  FS.mkdirTree(PATH.dirname(path));
+  var node = FS.createFile(PATH.dirname(path), PATH.basename(path), {}, true, false);
+  node.usedBytes = size;
+
+  var stream_ops = {};
+  Object.keys(node.stream_ops).forEach(function (key) {
+    stream_ops[key] = node.stream_ops[key];
+  });
+  stream_ops.read = function (stream, buffer, offset, length, position) {
+    var end = Math.min(size, position + length);
+    var written = 0;
+    while (position + written < end) {
+      var current = position + written;
+      var index = Math.floor(current / chunkSize);
+      var chunk = getChunk(index);
+      var start = current - index * chunkSize;
+      var count = Math.min(chunk.length - start, end - current);
+      buffer.set(chunk.subarray(start, start + count), offset + written);
+      written += count;
+    }
+    return written;
+  };
+  node.stream_ops = stream_ops;
+}
+
+Module['preRun'] = [].concat(Module['preRun'] || [], function () {
+  (Module['lazyDataManifests'] || []).forEach(function (manifestUrl) {
+    var dependency = 'lazy ' + manifestUrl;
+    addRunDependency(dependency);
+    vtkLazyReadManifest(manifestUrl, function (manifest) {
+      manifest['files'].forEach(function (entry) {
+        var url = entry['url'] ? vtkLazyResolve(manifestUrl, entry['url']) : null;
+        vtkLazyCreateFile(entry, url, manifestUrl);
+      });
+      removeRunDependency(dependency);
+    });
+  });
+});
@@ -1,9 +1,27 @@
 #!/bin/bash
 
+if [ $# -lt 1 ]
+then
+    echo "Usage: ./package_data.sh <emsdk_path> [--lazy|--shared]"
+    exit 1
+fi
+
 emsdk_path=$1
+mode=$2
+
+if [ "${mode}" == "--shared" ]
+then
+    python3 GenerateSharedBundles.py Data packaged_data
+    exit $?
+fi
 
 for f in Data/*
 do
     filename=$(basename ${f})
-    ${emsdk_path}/upstream/emscripten/tools/file_packager packaged_data/${filename}.data --preload ${f}@/ --js-output=packaged_data/${filename}.js
+    if [ "${mode}" == "--lazy" ]
+    then
+        python3 GenerateLazyManifest.py ${f} packaged_data
+    else
+        ${emsdk_path}/upstream/emscripten/tools/file_packager packaged_data/${filename}.data --preload ${f}@/ --js-output=packaged_data/${filename}.js
+    fi
 done
@@ -3,13 +3,45 @@
 mkdir gzip
 for file in $1/*
 do
+	if [ -d $file ]
+	then
+		continue
+	fi
 	filename=$(basename $file)
-	gzip -c $file > gzip/$filename
+	case $filename in
+		*.js) content_type=application/javascript ;;
+		*.json) content_type=application/json ;;
+		*) content_type=application/octet-stream ;;
+	esac
+	gzip -9 -c $file > gzip/$filename
 	aws s3api put-object \
 		--bucket vtk-wasm-examples \
 		--key data/$filename \
 		--body gzip/$filename \
+		--content-type $content_type \
 		--content-encoding gzip \
 		--acl public-read
 done
 rm -r gzip
+
+# Lazy packages are read with range requests, which address the stored
+# bytes: keep them uncompressed.
+if [ -d $1/lazy ]
+then
+	aws s3 sync $1/lazy s3://vtk-wasm-examples/data/lazy \
+		--acl public-read
+fi
+
+# Shared chunks are named after their content and never change, manifests
+# are small and must be revalidated.
+if [ -d $1/chunks ]
+then
+	aws s3 sync $1/chunks s3://vtk-wasm-examples/data/chunks \
+		--cache-control "public, max-age=31536000, immutable" \
+		--content-type application/octet-stream \
+		--acl public-read
+	aws s3 sync $1/manifests s3://vtk-wasm-examples/data/manifests \
+		--cache-control "no-cache" \
+		--content-type application/json \
+		--acl public-read
+fi
@@ -1,39 +1,42 @@
 #!/bin/bash
 
-if [ $# != 2 ]
+if [ $# -lt 2 ]
 then
-    echo "Usage: ./push_example.sh <example_name> <build_dir>"
+    echo "Usage: ./push_example.sh <example_name> <build_dir> [br|gzip]"
     exit 1
 fi
 
 example_name=$1
 build_dir=$2
+encoding=${3:-gzip}
+script_dir=$(dirname $(realpath $0))
 
-pushd ${build_dir}
+if [ "${encoding}" == "br" ]
+then
+    extension=br
+else
+    extension=gz
+fi
 
-gzip index.html
-aws s3api put-object \
-    --bucket vtk-wasm-examples \
-    --key ${example_name}/index.html \
-    --content-encoding gzip \
-    --body index.html.gz \
-    --acl public-read
+# push <file> <content_type>
+push() {
+    if [ ! -f $1.${extension} ] || [ $1 -nt $1.${extension} ]
+    then
+        node ${script_dir}/compress_artifacts.js $1 > /dev/null
+    fi
+    aws s3api put-object \
+        --bucket vtk-wasm-examples \
+        --key ${example_name}/$1 \
+        --body $1.${extension} \
+        --content-type $2 \
+        --content-encoding ${encoding} \
+        --acl public-read
+}
 
-gzip ${example_name}.js
-aws s3api put-object \
-    --bucket vtk-wasm-examples \
-    --key ${example_name}/${example_name}.js \
-    --body ${example_name}.js.gz \
-    --content-encoding gzip \
-    --acl public-read
+pushd ${build_dir}
 
-gzip ${example_name}.wasm
-aws s3api put-object \
-    --bucket vtk-wasm-examples \
-    --key ${example_name}/${example_name}.wasm \
-    --body ${example_name}.wasm.gz \
-    --content-type application/wasm \
-    --content-encoding gzip \
-    --acl public-read
+push index.html text/html
+push ${example_name}.js application/javascript
+push ${example_name}.wasm application/wasm
 
 popd
@@ -0,0 +1,82 @@
+import argparse
+import http.server
+import os
+import re
+import time
+
+class RangeRequestHandler(http.server.SimpleHTTPRequestHandler):
+    """
+    SimpleHTTPRequestHandler answering "Range: bytes=start-end" requests with 206,
+    which is what lazy data packages rely on. Files having a pre-compressed
+    <file>.br or <file>.gz variant (see compress_artifacts.js) are served
+    compressed to clients accepting it.
+    """
+
+    extensions_map = dict(http.server.SimpleHTTPRequestHandler.extensions_map,
+                          **{'.wasm': 'application/wasm', '.js': 'application/javascript'})
+    encodings = [('br', '.br'), ('gzip', '.gz')]
+    rate = None
+
+    def send_head(self):
+        match = re.fullmatch(r'bytes=(\d+)-(\d*)', self.headers.get('Range', ''))
+        path = self.translate_path(self.path)
+        self.range_remaining = None
+        if not os.path.isfile(path):
+            return super().send_head()
+        if not match:
+            return self.send_encoded(path) or super().send_head()
+        size = os.path.getsize(path)
+        start = int(match.group(1))
+        end = min(int(match.group(2)) if match.group(2) else size - 1, size - 1)
+        if start > end:
+            self.send_error(416, 'Requested Range Not Satisfiable')
+            return None
+        f = open(path, 'rb')
+        f.seek(start)
+        self.send_response(206)
+        self.send_header('Content-Type', self.guess_type(path))
+        self.send_header('Content-Range', 'bytes {}-{}/{}'.format(start, end, size))
+        self.send_header('Content-Length', str(end - start + 1))
+        self.send_header('Accept-Ranges', 'bytes')
+        self.end_headers()
+        self.range_remaining = end - start + 1
+        return f
+
+    def send_encoded(self, path):
+        accepted = [e.split(';')[0].strip() for e in self.headers.get('Accept-Encoding', '').split(',')]
+        for encoding, extension in self.encodings:
+            if encoding in accepted and os.path.isfile(path + extension):
+                self.send_response(200)
+                self.send_header('Content-Type', self.guess_type(path))
+                self.send_header('Content-Encoding', encoding)
+                self.send_header('Content-Length', str(os.path.getsize(path + extension)))
+                self.send_header('Vary', 'Accept-Encoding')
+                self.end_headers()
+                return open(path + extension, 'rb')
+        return None
+
+    def copyfile(self, source, outputfile):
+        remaining = self.range_remaining
+        while remaining is None or remaining > 0:
+            chunk = source.read(64 * 1024 if remaining is None else min(remaining, 64 * 1024))
+            if not chunk:
+                break
+            outputfile.write(chunk)
+            if remaining is not None:
+                remaining -= len(chunk)
+            if self.rate:
+                time.sleep(len(chunk) / self.rate)
+
+def main():
+    parser = argparse.ArgumentParser(description='Static file server supporting HTTP range requests and pre-compressed files.')
+    parser.add_argument('port', nargs='?', type=int, default=2000)
+    parser.add_argument('--directory', default=os.getcwd())
+    parser.add_argument('--rate', type=float, default=None, help='Throttle responses to this many KiB/s.')
+    args = parser.parse_args()
+    if args.rate:
+        RangeRequestHandler.rate = args.rate * 1024
+    handler = lambda *a, **kw: RangeRequestHandler(*a, directory=args.directory, **kw)
+    http.server.ThreadingHTTPServer(('', args.port), handler).serve_forever()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,876 @@
+#include <vtkAbstractCellLocator.h>
+#include <vtkCellLocator.h>
+#include <vtkCellTreeLocator.h>
+#include <vtkCellType.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkModifiedBSPTree.h>
+#include <vtkNew.h>
+#include <vtkOBBTree.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkTimerLog.h>
+#include <vtkTriangleFilter.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+// Bounding volume hierarchy over the triangles of a vtkPolyData, built with
+// the binned surface area heuristic: every split is the one of 16 candidate
+// planes per axis that minimizes the expected cost of a ray query. The nodes
+// live in one array, the two children of a node are next to each other, and
+// the triangles are copied in leaf order so that a leaf reads contiguous
+// memory. Cells that are not triangles are ignored.
+class BVHCellLocator
+{
+public:
+  void SetDataSet(vtkPolyData* polydata)
+  {
+    this->DataSet = polydata;
+  }
+
+  void BuildLocator();
+
+  // First intersection of the segment p1 p2 with the triangles, as
+  // vtkAbstractCellLocator::IntersectWithLine without a tolerance:
+  // t along the segment, x the point, pcoords the triangle coordinates.
+  int IntersectWithLine(const double p1[3], const double p2[3], double& t,
+                        double x[3], double pcoords[3], int& subId,
+                        vtkIdType& cellId) const;
+
+  // Closest point of the triangles, as vtkCellLocator::FindClosestPoint
+  void FindClosestPoint(const double x[3], double closestPoint[3],
+                        vtkIdType& cellId, int& subId, double& dist2) const;
+
+  // IntersectWithLine for every segment p1[i] p2[i], in parallel.
+  // cellIds[i] is -1 when segment i misses.
+  void IntersectWithLines(vtkPoints* p1, vtkPoints* p2,
+                          vtkIdTypeArray* cellIds, vtkDoubleArray* ts) const;
+
+  std::size_t GetNumberOfNodes() const
+  {
+    return this->Nodes.size();
+  }
+
+private:
+  struct Node
+  {
+    float Lo[3];
+    float Hi[3];
+    // Inner node: children First and First + 1, Count is 0.
+    // Leaf: triangles First ... First + Count - 1.
+    std::int32_t First;
+    std::int32_t Count;
+  };
+
+  struct Triangle
+  {
+    std::array<float, 3> V0;
+    std::array<float, 3> V1;
+    std::array<float, 3> V2;
+  };
+
+  void Split(std::int32_t nodeIndex, std::int32_t begin, std::int32_t end,
+             int depth, std::vector<std::int32_t>& order,
+             std::vector<std::array<float, 3>> const& centroids,
+             std::vector<std::array<float, 6>> const& bounds);
+
+  vtkPolyData* DataSet = nullptr;
+  std::vector<Node> Nodes;
+  std::vector<Triangle> Triangles;
+  std::vector<vtkIdType> CellIds;
+};
+
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfTriangles);
+
+// Segments from outside of polydata through a random point of its bounds
+void RandomSegments(vtkPolyData* polydata, vtkIdType numberOfSegments,
+                    vtkMinimalStandardRandomSequence* rng, vtkPoints* p1,
+                    vtkPoints* p2);
+
+// Middle of segment i, the random point of its bounds
+void Middle(vtkPoints* p1, vtkPoints* p2, vtkIdType i, double x[3]);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: BVHCellLocator [number of triangles] [number of rays]
+  vtkIdType numberOfTriangles = 1000000;
+  vtkIdType numberOfRays = 100000;
+  if (argc > 1)
+  {
+    numberOfTriangles = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfRays = std::atoll(argv[2]);
+  }
+  if (numberOfTriangles > 2 * 1024 * 1024)
+  {
+    std::cout << "vtkSphereSource makes at most " << 2 * 1024 * 1024
+              << " triangles" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto polydata = MakeSphere(numberOfTriangles);
+  polydata->BuildCells();
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  vtkNew<vtkPoints> p1;
+  vtkNew<vtkPoints> p2;
+  RandomSegments(polydata, numberOfRays, rng, p1, p2);
+  std::cout << polydata->GetNumberOfCells() << " triangles, " << numberOfRays
+            << " rays" << std::endl;
+
+  vtkNew<vtkTimerLog> timer;
+  double t;
+  double x[3];
+  double pcoords[3];
+  double closest[3];
+  double dist2;
+  int subId;
+  vtkIdType cellId;
+
+  std::cout << "locator,build_s,rays_s,closest_point_s" << std::endl;
+  std::vector<vtkSmartPointer<vtkAbstractCellLocator>> locators = {
+      vtkSmartPointer<vtkCellLocator>::New(),
+      vtkSmartPointer<vtkStaticCellLocator>::New(),
+      vtkSmartPointer<vtkCellTreeLocator>::New(),
+      vtkSmartPointer<vtkOBBTree>::New(),
+      vtkSmartPointer<vtkModifiedBSPTree>::New()};
+  for (auto& locator : locators)
+  {
+    locator->SetDataSet(polydata);
+    timer->StartTimer();
+    locator->BuildLocator();
+    timer->StopTimer();
+    double buildTime = timer->GetElapsedTime();
+
+    timer->StartTimer();
+    for (vtkIdType i = 0; i < numberOfRays; ++i)
+    {
+      locator->IntersectWithLine(p1->GetPoint(i), p2->GetPoint(i), 0.0, t, x,
+                                 pcoords, subId, cellId);
+    }
+    timer->StopTimer();
+    double rayTime = timer->GetElapsedTime();
+
+    // Only vtkCellLocator and vtkStaticCellLocator implement FindClosestPoint,
+    // the time of the others is 0.
+    double closestTime = 0.0;
+    if (locator->IsA("vtkCellLocator") || locator->IsA("vtkStaticCellLocator"))
+    {
+      timer->StartTimer();
+      for (vtkIdType i = 0; i < numberOfRays; ++i)
+      {
+        Middle(p1, p2, i, x);
+        locator->FindClosestPoint(x, closest, cellId, subId, dist2);
+      }
+      timer->StopTimer();
+      closestTime = timer->GetElapsedTime();
+    }
+    std::cout << locator->GetClassName() << "," << buildTime << "," << rayTime
+              << "," << closestTime << std::endl;
+  }
+
+  BVHCellLocator bvh;
+  bvh.SetDataSet(polydata);
+  timer->StartTimer();
+  bvh.BuildLocator();
+  timer->StopTimer();
+  double buildTime = timer->GetElapsedTime();
+
+  std::vector<vtkIdType> hits(numberOfRays);
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    hits[i] = -1;
+    bvh.IntersectWithLine(p1->GetPoint(i), p2->GetPoint(i), t, x, pcoords,
+                          subId, hits[i]);
+  }
+  timer->StopTimer();
+  double rayTime = timer->GetElapsedTime();
+
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    Middle(p1, p2, i, x);
+    bvh.FindClosestPoint(x, closest, cellId, subId, dist2);
+  }
+  timer->StopTimer();
+  std::cout << "BVHCellLocator," << buildTime << "," << rayTime << ","
+            << timer->GetElapsedTime() << std::endl;
+
+  vtkNew<vtkIdTypeArray> cellIds;
+  vtkNew<vtkDoubleArray> ts;
+  timer->StartTimer();
+  bvh.IntersectWithLines(p1, p2, cellIds, ts);
+  timer->StopTimer();
+  std::cout << "BVHCellLocator: " << bvh.GetNumberOfNodes() << " nodes, "
+            << timer->GetElapsedTime() << " s for the rays batched on "
+            << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads ("
+            << vtkSMPTools::GetBackend() << ")" << std::endl;
+
+  // The batched rays hit the same triangles, the first rays hit where
+  // vtkModifiedBSPTree says and the closest points are as far as
+  // vtkCellLocator says, up to the float precision of the triangles.
+  int mismatches = 0;
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    mismatches += cellIds->GetValue(i) != hits[i];
+  }
+  const double tolerance = 1.0e-5;
+  int rayDisagreements = 0;
+  int closestDisagreements = 0;
+  vtkIdType checks = std::min<vtkIdType>(numberOfRays, 1000);
+  auto rayReference = locators.back();
+  auto closestReference = locators.front();
+  for (vtkIdType i = 0; i < checks; ++i)
+  {
+    double expectedT = -1.0;
+    double bvhT = -1.0;
+    if (!rayReference->IntersectWithLine(p1->GetPoint(i), p2->GetPoint(i), 0.0,
+                                         expectedT, x, pcoords, subId, cellId))
+    {
+      expectedT = -1.0;
+    }
+    if (!bvh.IntersectWithLine(p1->GetPoint(i), p2->GetPoint(i), bvhT, x,
+                               pcoords, subId, cellId))
+    {
+      bvhT = -1.0;
+    }
+    rayDisagreements += std::abs(bvhT - expectedT) > tolerance;
+
+    double expectedDist2;
+    Middle(p1, p2, i, x);
+    closestReference->FindClosestPoint(x, closest, cellId, subId, expectedDist2);
+    bvh.FindClosestPoint(x, closest, cellId, subId, dist2);
+    closestDisagreements +=
+        std::abs(dist2 - expectedDist2) > tolerance * (1.0 + expectedDist2);
+  }
+  std::cout << mismatches << " batched mismatches, " << rayDisagreements
+            << " / " << checks << " ray disagreements with "
+            << rayReference->GetClassName() << ", " << closestDisagreements
+            << " / " << checks << " closest point disagreements with "
+            << closestReference->GetClassName() << std::endl;
+
+  return mismatches == 0 && rayDisagreements == 0 && closestDisagreements == 0
+      ? EXIT_SUCCESS
+      : EXIT_FAILURE;
+}
+
+namespace {
+constexpr int NumberOfBins = 16;
+constexpr std::int32_t MaxLeafSize = 8;
+constexpr int MaxDepth = 60;
+
+float HalfArea(const float lo[3], const float hi[3])
+{
+  float dx = hi[0] - lo[0];
+  float dy = hi[1] - lo[1];
+  float dz = hi[2] - lo[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+void BVHCellLocator::BuildLocator()
+{
+  this->Nodes.clear();
+  this->Triangles.clear();
+  this->CellIds.clear();
+
+  // Triangles, their bounds and centroids
+  std::vector<Triangle> triangles;
+  std::vector<vtkIdType> cellIds;
+  for (vtkIdType c = 0; c < this->DataSet->GetNumberOfCells(); ++c)
+  {
+    if (this->DataSet->GetCellType(c) != VTK_TRIANGLE)
+    {
+      continue;
+    }
+    vtkIdType npts;
+    const vtkIdType* pts;
+    this->DataSet->GetCellPoints(c, npts, pts);
+    Triangle triangle;
+    for (int v = 0; v < 3; ++v)
+    {
+      double p[3];
+      this->DataSet->GetPoint(pts[v], p);
+      auto& vertex = v == 0 ? triangle.V0 : v == 1 ? triangle.V1 : triangle.V2;
+      vertex = {static_cast<float>(p[0]), static_cast<float>(p[1]),
+                static_cast<float>(p[2])};
+    }
+    triangles.push_back(triangle);
+    cellIds.push_back(c);
+  }
+  auto n = static_cast<std::int32_t>(triangles.size());
+  if (n == 0)
+  {
+    return;
+  }
+
+  std::vector<std::array<float, 6>> bounds(n);
+  std::vector<std::array<float, 3>> centroids(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    auto const& tri = triangles[i];
+    for (int j = 0; j < 3; ++j)
+    {
+      bounds[i][2 * j] = std::min({tri.V0[j], tri.V1[j], tri.V2[j]});
+      bounds[i][2 * j + 1] = std::max({tri.V0[j], tri.V1[j], tri.V2[j]});
+      centroids[i][j] = (bounds[i][2 * j] + bounds[i][2 * j + 1]) / 2.0f;
+    }
+  }
+
+  std::vector<std::int32_t> order(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    order[i] = i;
+  }
+  this->Nodes.reserve(2 * static_cast<std::size_t>(n) / MaxLeafSize + 1);
+  this->Nodes.push_back(Node{});
+  this->Split(0, 0, n, 0, order, centroids, bounds);
+
+  this->Triangles.resize(n);
+  this->CellIds.resize(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    this->Triangles[i] = triangles[order[i]];
+    this->CellIds[i] = cellIds[order[i]];
+  }
+}
+
+void BVHCellLocator::Split(std::int32_t nodeIndex, std::int32_t begin,
+                           std::int32_t end, int depth,
+                           std::vector<std::int32_t>& order,
+                           std::vector<std::array<float, 3>> const& centroids,
+                           std::vector<std::array<float, 6>> const& bounds)
+{
+  // Bounds of the triangles and of their centroids
+  Node node;
+  float cLo[3];
+  float cHi[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    node.Lo[j] = cLo[j] = std::numeric_limits<float>::max();
+    node.Hi[j] = cHi[j] = std::numeric_limits<float>::lowest();
+  }
+  for (std::int32_t i = begin; i < end; ++i)
+  {
+    auto const& b = bounds[order[i]];
+    auto const& c = centroids[order[i]];
+    for (int j = 0; j < 3; ++j)
+    {
+      node.Lo[j] = std::min(node.Lo[j], b[2 * j]);
+      node.Hi[j] = std::max(node.Hi[j], b[2 * j + 1]);
+      cLo[j] = std::min(cLo[j], c[j]);
+      cHi[j] = std::max(cHi[j], c[j]);
+    }
+  }
+  std::int32_t count = end - begin;
+  node.First = begin;
+  node.Count = count;
+  this->Nodes[nodeIndex] = node;
+  // The traversal stacks hold 64 nodes
+  if (count <= 2 || depth == MaxDepth)
+  {
+    return;
+  }
+
+  // Binned SAH: cost of a split is 1 + (areaL * countL + areaR * countR) /
+  // area, the cost of a leaf is count.
+  float bestCost = std::numeric_limits<float>::max();
+  int bestAxis = -1;
+  int bestBin = 0;
+  float parentArea = std::max(HalfArea(node.Lo, node.Hi),
+                              std::numeric_limits<float>::min());
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    float extent = cHi[axis] - cLo[axis];
+    if (extent <= 0.0f)
+    {
+      continue;
+    }
+    struct Bin
+    {
+      float Lo[3];
+      float Hi[3];
+      std::int32_t Count = 0;
+    };
+    std::array<Bin, NumberOfBins> bins;
+    for (auto& bin : bins)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        bin.Lo[j] = std::numeric_limits<float>::max();
+        bin.Hi[j] = std::numeric_limits<float>::lowest();
+      }
+    }
+    float scale = NumberOfBins / extent;
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      auto const& b = bounds[order[i]];
+      int index = std::min(
+          NumberOfBins - 1,
+          static_cast<int>((centroids[order[i]][axis] - cLo[axis]) * scale));
+      auto& bin = bins[index];
+      ++bin.Count;
+      for (int j = 0; j < 3; ++j)
+      {
+        bin.Lo[j] = std::min(bin.Lo[j], b[2 * j]);
+        bin.Hi[j] = std::max(bin.Hi[j], b[2 * j + 1]);
+      }
+    }
+
+    // Sweep from the right, then from the left
+    std::array<float, NumberOfBins> rightCost;
+    Bin right;
+    for (int j = 0; j < 3; ++j)
+    {
+      right.Lo[j] = std::numeric_limits<float>::max();
+      right.Hi[j] = std::numeric_limits<float>::lowest();
+    }
+    for (int b = NumberOfBins - 1; b > 0; --b)
+    {
+      right.Count += bins[b].Count;
+      for (int j = 0; j < 3; ++j)
+      {
+        right.Lo[j] = std::min(right.Lo[j], bins[b].Lo[j]);
+        right.Hi[j] = std::max(right.Hi[j], bins[b].Hi[j]);
+      }
+      rightCost[b] = right.Count ? right.Count * HalfArea(right.Lo, right.Hi) : 0.0f;
+    }
+    Bin left = bins[0];
+    for (int b = 1; b < NumberOfBins; ++b)
+    {
+      if (left.Count > 0 && left.Count < count)
+      {
+        float cost = 1.0f +
+            (left.Count * HalfArea(left.Lo, left.Hi) + rightCost[b]) / parentArea;
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = b;
+        }
+      }
+      left.Count += bins[b].Count;
+      for (int j = 0; j < 3; ++j)
+      {
+        left.Lo[j] = std::min(left.Lo[j], bins[b].Lo[j]);
+        left.Hi[j] = std::max(left.Hi[j], bins[b].Hi[j]);
+      }
+    }
+  }
+
+  std::int32_t middle;
+  if (bestAxis < 0)
+  {
+    // All the centroids coincide, split the range in halves
+    if (count <= MaxLeafSize)
+    {
+      return;
+    }
+    middle = begin + count / 2;
+  }
+  else
+  {
+    if (bestCost >= count && count <= MaxLeafSize)
+    {
+      return;
+    }
+    float scale = NumberOfBins / (cHi[bestAxis] - cLo[bestAxis]);
+    auto it = std::partition(
+        order.begin() + begin, order.begin() + end, [&](std::int32_t i) {
+          int index = std::min(
+              NumberOfBins - 1,
+              static_cast<int>((centroids[i][bestAxis] - cLo[bestAxis]) * scale));
+          return index < bestBin;
+        });
+    middle = static_cast<std::int32_t>(it - order.begin());
+  }
+
+  auto first = static_cast<std::int32_t>(this->Nodes.size());
+  this->Nodes.push_back(Node{});
+  this->Nodes.push_back(Node{});
+  this->Nodes[nodeIndex].First = first;
+  this->Nodes[nodeIndex].Count = 0;
+  this->Split(first, begin, middle, depth + 1, order, centroids, bounds);
+  this->Split(first + 1, middle, end, depth + 1, order, centroids, bounds);
+}
+
+// Entry of the segment o + t d, 0 <= t <= tMax, in the box, or -1
+double EnterBox(const float lo[3], const float hi[3], const double o[3],
+                const double inverse[3], double tMax)
+{
+  double tNear = 0.0;
+  double tFar = tMax;
+  for (int j = 0; j < 3; ++j)
+  {
+    double t1 = (lo[j] - o[j]) * inverse[j];
+    double t2 = (hi[j] - o[j]) * inverse[j];
+    // NaN (0 * inf) when the segment lies in a face keeps the bounds
+    tNear = std::max(tNear, std::min(t1, t2));
+    tFar = std::min(tFar, std::max(t1, t2));
+  }
+  return tNear <= tFar ? tNear : -1.0;
+}
+
+// Möller-Trumbore: t along o + t d and the triangle coordinates u, v
+bool IntersectTriangle(std::array<float, 3> const& v0,
+                       std::array<float, 3> const& v1,
+                       std::array<float, 3> const& v2, const double o[3],
+                       const double d[3], double& t, double& u, double& v)
+{
+  double e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+  double e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+  double p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2],
+                 d[0] * e2[1] - d[1] * e2[0]};
+  double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+  if (det == 0.0)
+  {
+    return false;
+  }
+  double inverse = 1.0 / det;
+  double s[3] = {o[0] - v0[0], o[1] - v0[1], o[2] - v0[2]};
+  u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+  if (u < 0.0 || u > 1.0)
+  {
+    return false;
+  }
+  double q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2],
+                 s[0] * e1[1] - s[1] * e1[0]};
+  v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverse;
+  if (v < 0.0 || u + v > 1.0)
+  {
+    return false;
+  }
+  t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse;
+  return t >= 0.0;
+}
+
+int BVHCellLocator::IntersectWithLine(const double p1[3], const double p2[3],
+                                      double& t, double x[3],
+                                      double pcoords[3], int& subId,
+                                      vtkIdType& cellId) const
+{
+  if (this->Nodes.empty())
+  {
+    return 0;
+  }
+  double d[3] = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+  double inverse[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    inverse[j] = 1.0 / d[j];
+  }
+
+  double tBest = 1.0;
+  std::int32_t best = -1;
+  double uBest = 0.0;
+  double vBest = 0.0;
+  std::int32_t stack[64];
+  int top = 0;
+  if (EnterBox(this->Nodes[0].Lo, this->Nodes[0].Hi, p1, inverse, tBest) >= 0.0)
+  {
+    stack[top++] = 0;
+  }
+  while (top > 0)
+  {
+    auto const& node = this->Nodes[stack[--top]];
+    if (node.Count > 0)
+    {
+      for (std::int32_t i = node.First; i < node.First + node.Count; ++i)
+      {
+        auto const& tri = this->Triangles[i];
+        double ti;
+        double u;
+        double v;
+        if (IntersectTriangle(tri.V0, tri.V1, tri.V2, p1, d, ti, u, v) &&
+            ti <= tBest)
+        {
+          tBest = ti;
+          best = i;
+          uBest = u;
+          vBest = v;
+        }
+      }
+      continue;
+    }
+    // Closer child on top of the stack
+    auto const& a = this->Nodes[node.First];
+    auto const& b = this->Nodes[node.First + 1];
+    double ta = EnterBox(a.Lo, a.Hi, p1, inverse, tBest);
+    double tb = EnterBox(b.Lo, b.Hi, p1, inverse, tBest);
+    if (ta >= 0.0 && tb >= 0.0)
+    {
+      bool aFirst = ta <= tb;
+      stack[top++] = aFirst ? node.First + 1 : node.First;
+      stack[top++] = aFirst ? node.First : node.First + 1;
+    }
+    else if (ta >= 0.0)
+    {
+      stack[top++] = node.First;
+    }
+    else if (tb >= 0.0)
+    {
+      stack[top++] = node.First + 1;
+    }
+  }
+
+  if (best < 0)
+  {
+    return 0;
+  }
+  t = tBest;
+  for (int j = 0; j < 3; ++j)
+  {
+    x[j] = p1[j] + t * d[j];
+  }
+  pcoords[0] = uBest;
+  pcoords[1] = vBest;
+  pcoords[2] = 0.0;
+  subId = 0;
+  cellId = this->CellIds[best];
+  return 1;
+}
+
+// Closest point of the triangle v0 v1 v2 to p, from Ericson, Real-Time
+// Collision Detection, 5.1.5.
+void ClosestPointOnTriangle(const double p[3], std::array<float, 3> const& v0,
+                            std::array<float, 3> const& v1,
+                            std::array<float, 3> const& v2, double closest[3])
+{
+  double a[3] = {v0[0], v0[1], v0[2]};
+  double ab[3] = {v1[0] - a[0], v1[1] - a[1], v1[2] - a[2]};
+  double ac[3] = {v2[0] - a[0], v2[1] - a[1], v2[2] - a[2]};
+  double ap[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+  auto dot = [](const double u[3], const double v[3]) {
+    return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+  };
+  auto set = [&](double s, double t) {
+    for (int j = 0; j < 3; ++j)
+    {
+      closest[j] = a[j] + s * ab[j] + t * ac[j];
+    }
+  };
+
+  double d1 = dot(ab, ap);
+  double d2 = dot(ac, ap);
+  if (d1 <= 0.0 && d2 <= 0.0)
+  {
+    return set(0.0, 0.0);
+  }
+  double bp[3] = {p[0] - v1[0], p[1] - v1[1], p[2] - v1[2]};
+  double d3 = dot(ab, bp);
+  double d4 = dot(ac, bp);
+  if (d3 >= 0.0 && d4 <= d3)
+  {
+    return set(1.0, 0.0);
+  }
+  double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+  {
+    return set(d1 / (d1 - d3), 0.0);
+  }
+  double cp[3] = {p[0] - v2[0], p[1] - v2[1], p[2] - v2[2]};
+  double d5 = dot(ab, cp);
+  double d6 = dot(ac, cp);
+  if (d6 >= 0.0 && d5 <= d6)
+  {
+    return set(0.0, 1.0);
+  }
+  double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+  {
+    return set(0.0, d2 / (d2 - d6));
+  }
+  double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+  {
+    double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return set(1.0 - w, w);
+  }
+  double denominator = 1.0 / (va + vb + vc);
+  set(vb * denominator, vc * denominator);
+}
+
+double BoxDistance2(const float lo[3], const float hi[3], const double x[3])
+{
+  double distance2 = 0.0;
+  for (int j = 0; j < 3; ++j)
+  {
+    double d = std::max({lo[j] - x[j], 0.0, x[j] - hi[j]});
+    distance2 += d * d;
+  }
+  return distance2;
+}
+
+void BVHCellLocator::FindClosestPoint(const double x[3],
+                                      double closestPoint[3],
+                                      vtkIdType& cellId, int& subId,
+                                      double& dist2) const
+{
+  cellId = -1;
+  subId = 0;
+  dist2 = std::numeric_limits<double>::max();
+  if (this->Nodes.empty())
+  {
+    return;
+  }
+
+  std::pair<double, std::int32_t> stack[64];
+  int top = 0;
+  stack[top++] = {0.0, 0};
+  while (top > 0)
+  {
+    auto item = stack[--top];
+    if (item.first >= dist2)
+    {
+      continue;
+    }
+    auto const& node = this->Nodes[item.second];
+    if (node.Count > 0)
+    {
+      for (std::int32_t i = node.First; i < node.First + node.Count; ++i)
+      {
+        auto const& tri = this->Triangles[i];
+        double point[3];
+        ClosestPointOnTriangle(x, tri.V0, tri.V1, tri.V2, point);
+        double distance2 = (point[0] - x[0]) * (point[0] - x[0]) +
+            (point[1] - x[1]) * (point[1] - x[1]) +
+            (point[2] - x[2]) * (point[2] - x[2]);
+        if (distance2 < dist2)
+        {
+          dist2 = distance2;
+          cellId = this->CellIds[i];
+          std::copy(point, point + 3, closestPoint);
+        }
+      }
+      continue;
+    }
+    auto const& a = this->Nodes[node.First];
+    auto const& b = this->Nodes[node.First + 1];
+    double da = BoxDistance2(a.Lo, a.Hi, x);
+    double db = BoxDistance2(b.Lo, b.Hi, x);
+    if (da <= db)
+    {
+      stack[top++] = {db, node.First + 1};
+      stack[top++] = {da, node.First};
+    }
+    else
+    {
+      stack[top++] = {da, node.First};
+      stack[top++] = {db, node.First + 1};
+    }
+  }
+}
+
+void BVHCellLocator::IntersectWithLines(vtkPoints* p1, vtkPoints* p2,
+                                        vtkIdTypeArray* cellIds,
+                                        vtkDoubleArray* ts) const
+{
+  vtkIdType numberOfLines = p1->GetNumberOfPoints();
+  cellIds->SetNumberOfValues(numberOfLines);
+  ts->SetNumberOfValues(numberOfLines);
+  vtkIdType* ids = cellIds->GetPointer(0);
+  double* t = ts->GetPointer(0);
+  vtkSMPTools::For(0, numberOfLines, [&](vtkIdType begin, vtkIdType end) {
+    double a[3];
+    double b[3];
+    double x[3];
+    double pcoords[3];
+    int subId;
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      p1->GetPoint(i, a);
+      p2->GetPoint(i, b);
+      if (!this->IntersectWithLine(a, b, t[i], x, pcoords, subId, ids[i]))
+      {
+        ids[i] = -1;
+        t[i] = -1.0;
+      }
+    }
+  });
+}
+
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfTriangles)
+{
+  // A sphere of resolution r x r has about 2 r * r triangles.
+  auto resolution = static_cast<int>(
+      std::sqrt(static_cast<double>(numberOfTriangles) / 2.0));
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(std::max(3, resolution));
+  sphere->SetPhiResolution(std::max(3, resolution));
+  vtkNew<vtkTriangleFilter> triangles;
+  triangles->SetInputConnection(sphere->GetOutputPort());
+  triangles->Update();
+  return triangles->GetOutput();
+}
+
+void RandomSegments(vtkPolyData* polydata, vtkIdType numberOfSegments,
+                    vtkMinimalStandardRandomSequence* rng, vtkPoints* p1,
+                    vtkPoints* p2)
+{
+  double bounds[6];
+  polydata->GetBounds(bounds);
+  double center[3];
+  polydata->GetCenter(center);
+  double radius = polydata->GetLength();
+  p1->SetDataTypeToDouble();
+  p2->SetDataTypeToDouble();
+  p1->SetNumberOfPoints(numberOfSegments);
+  p2->SetNumberOfPoints(numberOfSegments);
+  for (vtkIdType i = 0; i < numberOfSegments; ++i)
+  {
+    // A start on a sphere around the bounds, in a random direction
+    double p[3];
+    double norm2;
+    do
+    {
+      norm2 = 0.0;
+      for (int j = 0; j < 3; ++j)
+      {
+        p[j] = rng->GetRangeValue(-1.0, 1.0);
+        rng->Next();
+        norm2 += p[j] * p[j];
+      }
+    } while (norm2 > 1.0 || norm2 < 1.0e-6);
+    double scale = radius / std::sqrt(norm2);
+    double target[3];
+    for (int j = 0; j < 3; ++j)
+    {
+      p[j] = center[j] + scale * p[j];
+      target[j] = rng->GetRangeValue(bounds[2 * j], bounds[2 * j + 1]);
+      rng->Next();
+    }
+    p1->SetPoint(i, p);
+    // The end as far beyond the target
+    p2->SetPoint(i, 2.0 * target[0] - p[0], 2.0 * target[1] - p[1],
+                 2.0 * target[2] - p[2]);
+  }
+}
+
+void Middle(vtkPoints* p1, vtkPoints* p2, vtkIdType i, double x[3])
+{
+  double a[3];
+  double b[3];
+  p1->GetPoint(i, a);
+  p2->GetPoint(i, b);
+  for (int j = 0; j < 3; ++j)
+  {
+    x[j] = (a[j] + b[j]) / 2.0;
+  }
+}
+} // namespace
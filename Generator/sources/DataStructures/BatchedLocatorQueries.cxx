@@ -0,0 +1,308 @@
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkPointSource.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPThreadLocalObject.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+namespace {
+// Batched queries on a built vtkStaticPointLocator, whose queries are thread
+// safe. Results are stored in the order of the queries.
+//
+// FindClosestPoints: ids[i] is the closest point of query i.
+// FindPointsWithinRadius: the points of query i are
+//   ids[offsets[i]] ... ids[offsets[i + 1] - 1]
+void FindClosestPoints(vtkStaticPointLocator* locator, vtkPoints* queries,
+                       vtkIdTypeArray* ids);
+
+void FindPointsWithinRadius(vtkStaticPointLocator* locator, double radius,
+                            vtkPoints* queries, vtkIdTypeArray* offsets,
+                            vtkIdTypeArray* ids);
+
+// Query indices sorted along a Morton curve: consecutive queries then touch
+// the same buckets of the locator.
+std::vector<vtkIdType> SpatialOrder(vtkPoints* queries);
+
+vtkSmartPointer<vtkPoints>
+RandomPointsInBounds(double bounds[6], vtkIdType numberOfPoints,
+                     vtkMinimalStandardRandomSequence* rng);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: BatchedLocatorQueries [number of points] [number of queries]
+  vtkIdType numberOfPoints = 1000000;
+  vtkIdType numberOfQueries = 1000000;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfQueries = std::atoll(argv[2]);
+  }
+
+  vtkNew<vtkPointSource> pointSource;
+  pointSource->SetNumberOfPoints(numberOfPoints);
+  pointSource->SetRadius(1.0);
+  pointSource->Update();
+  auto polydata = pointSource->GetOutput();
+
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  double bounds[6];
+  polydata->GetBounds(bounds);
+  auto queries = RandomPointsInBounds(bounds, numberOfQueries, rng);
+
+  vtkNew<vtkStaticPointLocator> locator;
+  locator->SetDataSet(polydata);
+  locator->BuildLocator();
+
+  // About 8 points within the radius, the points fill a sphere of volume 4/3 pi.
+  double radius = std::cbrt(8.0 / numberOfPoints);
+
+  std::cout << vtkSMPTools::GetBackend() << " backend, "
+            << vtkSMPTools::GetEstimatedNumberOfThreads() << " threads, "
+            << numberOfPoints << " points, " << numberOfQueries << " queries"
+            << std::endl;
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkIdList> result;
+
+  // One call per query
+  std::vector<vtkIdType> closest(numberOfQueries);
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfQueries; ++i)
+  {
+    closest[i] = locator->FindClosestPoint(queries->GetPoint(i));
+  }
+  timer->StopTimer();
+  double scalarClosest = timer->GetElapsedTime();
+
+  vtkIdType scalarFound = 0;
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfQueries; ++i)
+  {
+    locator->FindPointsWithinRadius(radius, queries->GetPoint(i), result);
+    scalarFound += result->GetNumberOfIds();
+  }
+  timer->StopTimer();
+  double scalarRadius = timer->GetElapsedTime();
+
+  // Batched
+  vtkNew<vtkIdTypeArray> closestIds;
+  timer->StartTimer();
+  FindClosestPoints(locator, queries, closestIds);
+  timer->StopTimer();
+  double batchedClosest = timer->GetElapsedTime();
+
+  vtkNew<vtkIdTypeArray> offsets;
+  vtkNew<vtkIdTypeArray> ids;
+  timer->StartTimer();
+  FindPointsWithinRadius(locator, radius, queries, offsets, ids);
+  timer->StopTimer();
+  double batchedRadius = timer->GetElapsedTime();
+
+  vtkIdType mismatches = 0;
+  for (vtkIdType i = 0; i < numberOfQueries; ++i)
+  {
+    if (closestIds->GetValue(i) != closest[i])
+    {
+      ++mismatches;
+    }
+  }
+
+  std::cout << "FindClosestPoint:       " << scalarClosest << " s one by one, "
+            << batchedClosest << " s batched, "
+            << scalarClosest / batchedClosest << "x, " << mismatches
+            << " mismatches" << std::endl;
+  std::cout << "FindPointsWithinRadius: " << scalarRadius << " s one by one, "
+            << batchedRadius << " s batched, " << scalarRadius / batchedRadius
+            << "x, " << scalarFound << " / " << ids->GetNumberOfValues()
+            << " points found" << std::endl;
+
+  return mismatches == 0 && scalarFound == ids->GetNumberOfValues()
+      ? EXIT_SUCCESS
+      : EXIT_FAILURE;
+}
+
+namespace {
+// Spreads the 10 low bits of v over 30 bits, two zeros between each bit.
+std::uint32_t SpreadBits(std::uint32_t v)
+{
+  v = (v | (v << 16)) & 0x030000FF;
+  v = (v | (v << 8)) & 0x0300F00F;
+  v = (v | (v << 4)) & 0x030C30C3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+std::vector<vtkIdType> SpatialOrder(vtkPoints* queries)
+{
+  vtkIdType numberOfQueries = queries->GetNumberOfPoints();
+  double bounds[6];
+  queries->GetBounds(bounds);
+
+  std::vector<std::uint32_t> codes(numberOfQueries);
+  vtkSMPTools::For(0, numberOfQueries, [&](vtkIdType begin, vtkIdType end) {
+    double p[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      queries->GetPoint(i, p);
+      std::uint32_t code = 0;
+      for (int j = 0; j < 3; ++j)
+      {
+        double length = bounds[2 * j + 1] - bounds[2 * j];
+        double t = length > 0.0 ? (p[j] - bounds[2 * j]) / length : 0.0;
+        auto cell = static_cast<std::uint32_t>(
+            std::min(1023.0, std::max(0.0, t * 1024.0)));
+        code |= SpreadBits(cell) << j;
+      }
+      codes[i] = code;
+    }
+  });
+
+  std::vector<vtkIdType> order(numberOfQueries);
+  std::iota(order.begin(), order.end(), 0);
+  vtkSMPTools::Sort(order.begin(), order.end(),
+                    [&](vtkIdType a, vtkIdType b) { return codes[a] < codes[b]; });
+  return order;
+}
+
+struct ClosestPointWorker
+{
+  vtkStaticPointLocator* Locator;
+  vtkPoints* Queries;
+  const std::vector<vtkIdType>& Order;
+  vtkIdType* Ids;
+
+  void operator()(vtkIdType begin, vtkIdType end)
+  {
+    double p[3];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      vtkIdType query = this->Order[i];
+      this->Queries->GetPoint(query, p);
+      this->Ids[query] = this->Locator->FindClosestPoint(p);
+    }
+  }
+};
+
+void FindClosestPoints(vtkStaticPointLocator* locator, vtkPoints* queries,
+                       vtkIdTypeArray* ids)
+{
+  vtkIdType numberOfQueries = queries->GetNumberOfPoints();
+  ids->SetNumberOfValues(numberOfQueries);
+  auto order = SpatialOrder(queries);
+  ClosestPointWorker worker{locator, queries, order, ids->GetPointer(0)};
+  vtkSMPTools::For(0, numberOfQueries, worker);
+}
+
+// The sorted queries are cut in blocks, each block collects the points of its
+// queries in its own buffer. The buffers are then scattered into the CSR
+// arrays, in query order.
+struct RadiusWorker
+{
+  static constexpr vtkIdType BlockSize = 1024;
+
+  vtkStaticPointLocator* Locator;
+  double Radius;
+  vtkPoints* Queries;
+  const std::vector<vtkIdType>& Order;
+  std::vector<std::vector<vtkIdType>>& Blocks;
+  // Count of each query, then where its points start in its block
+  std::vector<vtkIdType>& Counts;
+  std::vector<vtkIdType>& Starts;
+  vtkSMPThreadLocalObject<vtkIdList> Result;
+
+  void operator()(vtkIdType beginBlock, vtkIdType endBlock)
+  {
+    vtkIdList* result = this->Result.Local();
+    auto numberOfQueries = static_cast<vtkIdType>(this->Order.size());
+    double p[3];
+    for (vtkIdType block = beginBlock; block < endBlock; ++block)
+    {
+      auto& buffer = this->Blocks[block];
+      vtkIdType end = std::min(numberOfQueries, (block + 1) * BlockSize);
+      for (vtkIdType i = block * BlockSize; i < end; ++i)
+      {
+        vtkIdType query = this->Order[i];
+        this->Queries->GetPoint(query, p);
+        this->Locator->FindPointsWithinRadius(this->Radius, p, result);
+        this->Starts[query] = static_cast<vtkIdType>(buffer.size());
+        this->Counts[query] = result->GetNumberOfIds();
+        buffer.insert(buffer.end(), result->GetPointer(0),
+                      result->GetPointer(0) + result->GetNumberOfIds());
+      }
+    }
+  }
+};
+
+void FindPointsWithinRadius(vtkStaticPointLocator* locator, double radius,
+                            vtkPoints* queries, vtkIdTypeArray* offsets,
+                            vtkIdTypeArray* ids)
+{
+  vtkIdType numberOfQueries = queries->GetNumberOfPoints();
+  auto order = SpatialOrder(queries);
+  vtkIdType numberOfBlocks =
+      (numberOfQueries + RadiusWorker::BlockSize - 1) / RadiusWorker::BlockSize;
+
+  std::vector<std::vector<vtkIdType>> blocks(numberOfBlocks);
+  std::vector<vtkIdType> counts(numberOfQueries);
+  std::vector<vtkIdType> starts(numberOfQueries);
+  RadiusWorker worker{locator, radius, queries, order, blocks, counts, starts, {}};
+  vtkSMPTools::For(0, numberOfBlocks, 1, worker);
+
+  offsets->SetNumberOfValues(numberOfQueries + 1);
+  vtkIdType* offset = offsets->GetPointer(0);
+  offset[0] = 0;
+  std::partial_sum(counts.begin(), counts.end(), offset + 1);
+
+  ids->SetNumberOfValues(offset[numberOfQueries]);
+  vtkIdType* id = ids->GetPointer(0);
+  vtkSMPTools::For(0, numberOfQueries, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      vtkIdType query = order[i];
+      const vtkIdType* source = blocks[i / RadiusWorker::BlockSize].data() + starts[query];
+      std::copy(source, source + counts[query], id + offset[query]);
+    }
+  });
+}
+
+vtkSmartPointer<vtkPoints>
+RandomPointsInBounds(double bounds[6], vtkIdType numberOfPoints,
+                     vtkMinimalStandardRandomSequence* rng)
+{
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    double p[3];
+    for (auto j = 0; j < 3; ++j)
+    {
+      p[j] = bounds[j * 2] +
+          (bounds[j * 2 + 1] - bounds[j * 2]) * rng->GetRangeValue(0.0, 1.0);
+      rng->Next();
+    }
+    points->SetPoint(i, p);
+  }
+  return points;
+}
+} // namespace
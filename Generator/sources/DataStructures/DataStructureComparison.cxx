@@ -1,8 +1,11 @@
 #include <vtkActor.h>
 #include <vtkCamera.h>
+#include <vtkCellArray.h>
+#include <vtkCellType.h>
 #include <vtkInteractorStyleTrackballCamera.h>
 #include <vtkNew.h>
 #include <vtkPointSource.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
@@ -17,9 +20,48 @@
 #include <vtkOBBTree.h>
 #include <vtkOctreePointLocator.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 namespace {
+// Bounding volume hierarchy over the triangles, split with the binned surface
+// area heuristic as in BVHCellLocator, with the same constants and float
+// boxes. Only the boxes of the nodes are kept, to draw them as the locators
+// draw theirs.
+class BVHBoxes
+{
+public:
+  void Build(vtkPolyData* polydata);
+
+  int GetLevel() const
+  {
+    return this->Level;
+  }
+
+  // The boxes of the nodes at level, and of the leaves above it
+  void GenerateRepresentation(int level, vtkPolyData* polydata) const;
+
+private:
+  struct Node
+  {
+    float Lo[3];
+    float Hi[3];
+    int Level;
+    bool Leaf;
+  };
+
+  void Split(std::int32_t begin, std::int32_t end, int level);
+
+  std::vector<std::array<float, 6>> Bounds;
+  std::vector<std::array<float, 3>> Centroids;
+  std::vector<std::int32_t> Order;
+  std::vector<Node> Nodes;
+  int Level = 0;
+};
+
 class KeyPressInteractorStyle : public vtkInteractorStyleTrackballCamera
 {
 public:
@@ -27,6 +69,7 @@ public:
   vtkSmartPointer<vtkPolyData> data;
   std::vector<vtkRenderer*> renderers;
   std::vector<vtkSmartPointer<vtkLocator>> trees;
+  BVHBoxes bvh;
   std::vector<vtkSmartPointer<vtkPolyDataMapper>> mappers;
   std::vector<vtkSmartPointer<vtkActor>> actors;
 
@@ -36,7 +79,8 @@ public:
   void Initialize()
   {
     this->meshMapper->SetInputData(this->data);
-    for (unsigned int i = 0; i < 4; i++)
+    this->bvh.Build(this->data);
+    for (unsigned int i = 0; i < this->renderers.size(); i++)
     {
       vtkSmartPointer<vtkPolyDataMapper> mapper =
           vtkSmartPointer<vtkPolyDataMapper>::New();
@@ -108,7 +152,7 @@ public:
   {
 
     std::cout << "Level " << this->Level << std::endl;
-    for (unsigned i = 0; i < 4; i++)
+    for (unsigned i = 0; i < this->trees.size(); i++)
     {
 
       vtkSmartPointer<vtkLocator> tree = this->trees[i];
@@ -134,6 +178,13 @@ public:
       this->mappers[i]->SetInputData(polydata);
     }
 
+    // The hierarchy of the last viewport is not a vtkLocator
+    vtkSmartPointer<vtkPolyData> polydata = vtkSmartPointer<vtkPolyData>::New();
+    std::cout << "BVH has " << this->bvh.GetLevel() << " levels." << std::endl;
+    this->bvh.GenerateRepresentation(std::min(this->Level, this->bvh.GetLevel()),
+                                     polydata);
+    this->mappers[this->trees.size()]->SetInputData(polydata);
+
     this->Interactor->GetRenderWindow()->Render();
   }
 
@@ -165,7 +216,7 @@ int main(int argc, char* argv[])
     originalMesh->ShallowCopy(sphereSource->GetOutput());
   }
 
-  double numberOfViewports = 4.;
+  double numberOfViewports = 5.;
 
   vtkNew<vtkRenderWindow> renderWindow;
   renderWindow->SetSize(200 * numberOfViewports, 200); //(width, height)
@@ -176,7 +227,7 @@ int main(int argc, char* argv[])
 
   vtkNew<vtkCamera> camera;
 
-  for (unsigned int i = 0; i < 4; i++)
+  for (unsigned int i = 0; i < numberOfViewports; i++)
   {
     vtkNew<vtkRenderer> renderer;
     renderWindow->AddRenderer(renderer);
@@ -197,3 +248,225 @@ int main(int argc, char* argv[])
 
   return EXIT_SUCCESS;
 }
+
+namespace {
+constexpr int NumberOfBins = 16;
+constexpr std::int32_t MaxLeafSize = 8;
+constexpr int MaxDepth = 60;
+
+float HalfArea(const float lo[3], const float hi[3])
+{
+  float dx = hi[0] - lo[0];
+  float dy = hi[1] - lo[1];
+  float dz = hi[2] - lo[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+void BVHBoxes::Build(vtkPolyData* polydata)
+{
+  this->Bounds.clear();
+  this->Centroids.clear();
+  this->Order.clear();
+  this->Nodes.clear();
+  this->Level = 0;
+  for (vtkIdType c = 0; c < polydata->GetNumberOfCells(); c++)
+  {
+    if (polydata->GetCellType(c) != VTK_TRIANGLE)
+    {
+      continue;
+    }
+    double b[6];
+    polydata->GetCellBounds(c, b);
+    std::array<float, 6> bounds;
+    std::array<float, 3> centroid;
+    for (int j = 0; j < 3; j++)
+    {
+      bounds[2 * j] = static_cast<float>(b[2 * j]);
+      bounds[2 * j + 1] = static_cast<float>(b[2 * j + 1]);
+      centroid[j] = (bounds[2 * j] + bounds[2 * j + 1]) / 2.0f;
+    }
+    this->Order.push_back(static_cast<std::int32_t>(this->Bounds.size()));
+    this->Bounds.push_back(bounds);
+    this->Centroids.push_back(centroid);
+  }
+  if (!this->Order.empty())
+  {
+    this->Split(0, static_cast<std::int32_t>(this->Order.size()), 0);
+  }
+}
+
+void BVHBoxes::Split(std::int32_t begin, std::int32_t end, int level)
+{
+  // Bounds of the triangles and of their centroids
+  Node node;
+  float cLo[3];
+  float cHi[3];
+  for (int j = 0; j < 3; j++)
+  {
+    node.Lo[j] = cLo[j] = std::numeric_limits<float>::max();
+    node.Hi[j] = cHi[j] = std::numeric_limits<float>::lowest();
+  }
+  for (std::int32_t i = begin; i < end; i++)
+  {
+    auto const& b = this->Bounds[this->Order[i]];
+    auto const& c = this->Centroids[this->Order[i]];
+    for (int j = 0; j < 3; j++)
+    {
+      node.Lo[j] = std::min(node.Lo[j], b[2 * j]);
+      node.Hi[j] = std::max(node.Hi[j], b[2 * j + 1]);
+      cLo[j] = std::min(cLo[j], c[j]);
+      cHi[j] = std::max(cHi[j], c[j]);
+    }
+  }
+  node.Level = level;
+  node.Leaf = true;
+  auto nodeIndex = this->Nodes.size();
+  this->Nodes.push_back(node);
+  this->Level = std::max(this->Level, level);
+  std::int32_t count = end - begin;
+  if (count <= 2 || level == MaxDepth)
+  {
+    return;
+  }
+
+  // Binned SAH: the cost of a split is 1 + (areaL * countL + areaR * countR) /
+  // area, the cost of a leaf is count.
+  struct Bin
+  {
+    float Lo[3];
+    float Hi[3];
+    std::int32_t Count = 0;
+  };
+  auto empty = []() {
+    Bin bin;
+    for (int j = 0; j < 3; j++)
+    {
+      bin.Lo[j] = std::numeric_limits<float>::max();
+      bin.Hi[j] = std::numeric_limits<float>::lowest();
+    }
+    return bin;
+  };
+  auto merge = [](Bin& bin, Bin const& other) {
+    bin.Count += other.Count;
+    for (int j = 0; j < 3; j++)
+    {
+      bin.Lo[j] = std::min(bin.Lo[j], other.Lo[j]);
+      bin.Hi[j] = std::max(bin.Hi[j], other.Hi[j]);
+    }
+  };
+  auto binOf = [&](std::int32_t triangle, int axis) {
+    float scale = NumberOfBins / (cHi[axis] - cLo[axis]);
+    return std::min(NumberOfBins - 1,
+                    static_cast<int>(
+                        (this->Centroids[triangle][axis] - cLo[axis]) * scale));
+  };
+  float bestCost = std::numeric_limits<float>::max();
+  int bestAxis = -1;
+  int bestBin = 0;
+  float parentArea = std::max(HalfArea(node.Lo, node.Hi),
+                              std::numeric_limits<float>::min());
+  for (int axis = 0; axis < 3; axis++)
+  {
+    if (cHi[axis] - cLo[axis] <= 0.0f)
+    {
+      continue;
+    }
+    std::array<Bin, NumberOfBins> bins;
+    bins.fill(empty());
+    for (std::int32_t i = begin; i < end; i++)
+    {
+      auto const& b = this->Bounds[this->Order[i]];
+      auto& bin = bins[binOf(this->Order[i], axis)];
+      bin.Count++;
+      for (int j = 0; j < 3; j++)
+      {
+        bin.Lo[j] = std::min(bin.Lo[j], b[2 * j]);
+        bin.Hi[j] = std::max(bin.Hi[j], b[2 * j + 1]);
+      }
+    }
+    // Sweep from the right, then from the left
+    std::array<float, NumberOfBins> rightCost;
+    Bin right = empty();
+    for (int b = NumberOfBins - 1; b > 0; b--)
+    {
+      merge(right, bins[b]);
+      rightCost[b] = right.Count ? right.Count * HalfArea(right.Lo, right.Hi) : 0.0f;
+    }
+    Bin left = bins[0];
+    for (int b = 1; b < NumberOfBins; b++)
+    {
+      if (left.Count > 0 && left.Count < count)
+      {
+        float cost = 1.0f +
+            (left.Count * HalfArea(left.Lo, left.Hi) + rightCost[b]) / parentArea;
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = b;
+        }
+      }
+      merge(left, bins[b]);
+    }
+  }
+
+  std::int32_t middle;
+  if (bestAxis < 0)
+  {
+    // All the centroids coincide, split the range in halves
+    if (count <= MaxLeafSize)
+    {
+      return;
+    }
+    middle = begin + count / 2;
+  }
+  else
+  {
+    if (bestCost >= count && count <= MaxLeafSize)
+    {
+      return;
+    }
+    auto it = std::partition(
+        this->Order.begin() + begin, this->Order.begin() + end,
+        [&](std::int32_t triangle) { return binOf(triangle, bestAxis) < bestBin; });
+    middle = static_cast<std::int32_t>(it - this->Order.begin());
+  }
+  this->Nodes[nodeIndex].Leaf = false;
+  this->Split(begin, middle, level + 1);
+  this->Split(middle, end, level + 1);
+}
+
+void BVHBoxes::GenerateRepresentation(int level, vtkPolyData* polydata) const
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> polys;
+  // The 6 faces of a box, its corners numbered by the bits x, y, z
+  const vtkIdType faces[6][4] = {{0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1},
+                                 {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+  for (auto const& node : this->Nodes)
+  {
+    if (node.Level != level && !(node.Leaf && node.Level < level))
+    {
+      continue;
+    }
+    vtkIdType first = points->GetNumberOfPoints();
+    for (int corner = 0; corner < 8; corner++)
+    {
+      points->InsertNextPoint(corner & 1 ? node.Hi[0] : node.Lo[0],
+                              corner & 2 ? node.Hi[1] : node.Lo[1],
+                              corner & 4 ? node.Hi[2] : node.Lo[2]);
+    }
+    for (auto const& face : faces)
+    {
+      vtkIdType ids[4];
+      for (int k = 0; k < 4; k++)
+      {
+        ids[k] = first + face[k];
+      }
+      polys->InsertNextCell(4, ids);
+    }
+  }
+  polydata->SetPoints(points);
+  polydata->SetPolys(polys);
+}
+} // namespace
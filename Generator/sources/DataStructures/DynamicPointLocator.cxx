@@ -0,0 +1,545 @@
+#include <vtkIdList.h>
+#include <vtkKdTreePointLocator.h>
+#include <vtkMath.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+// A uniform grid of buckets, like vtkStaticPointLocator, whose buckets are
+// growable lists: inserting, removing or moving a point only touches the
+// buckets it leaves and enters. The grid is rebuilt (rebalanced) when a point
+// leaves the padded bounds or when the number of points doubled or halved
+// since the last build, which keeps the cost amortized O(1) per update.
+class DynamicPointLocator
+{
+public:
+  void Initialize(vtkPoints* points);
+
+  void InsertPoint(vtkIdType id, const double x[3]);
+  void RemovePoint(vtkIdType id);
+  void MovePoint(vtkIdType id, const double x[3]);
+
+  vtkIdType FindClosestPoint(const double x[3]) const;
+  void FindPointsWithinRadius(double radius, const double x[3],
+                              vtkIdList* result) const;
+
+  int GetNumberOfRebuilds() const
+  {
+    return this->NumberOfRebuilds;
+  }
+
+private:
+  static constexpr int PointsPerBucket = 4;
+  static constexpr double Padding = 0.1;
+
+  void Rebuild();
+  vtkIdType GetBucket(const double x[3], int ijk[3]) const;
+  bool IsInside(const double x[3]) const;
+  void AddToBucket(vtkIdType id, vtkIdType bucket);
+  void RemoveFromBucket(vtkIdType id);
+
+  std::vector<std::array<double, 3>> Positions;
+  // Bucket of each point (-1 when removed), and its slot in that bucket
+  std::vector<vtkIdType> BucketOf;
+  std::vector<vtkIdType> SlotOf;
+  std::vector<std::vector<vtkIdType>> Buckets;
+  vtkIdType NumberOfPoints = 0;
+  vtkIdType NumberOfPointsAtBuild = 0;
+  double Bounds[6];
+  double H[3];
+  int Divisions[3];
+  int NumberOfRebuilds = 0;
+};
+
+// Copies the points of the present ids, in that order
+void CopyPresentPoints(vtkPoints* points, std::vector<vtkIdType> const& present,
+                       vtkPoints* presentPoints);
+
+// A random point of the unit cube
+std::array<double, 3> RandomPoint(vtkMinimalStandardRandomSequence* rng);
+
+// A random index below size
+size_t RandomIndex(size_t size, vtkMinimalStandardRandomSequence* rng);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: DynamicPointLocator [number of points] [number of frames] [updated fraction]
+  vtkIdType numberOfPoints = 1000000;
+  int numberOfFrames = 20;
+  double updatedFraction = 0.01;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfFrames = std::atoi(argv[2]);
+  }
+  if (argc > 3)
+  {
+    updatedFraction = std::atof(argv[3]);
+  }
+
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+
+  // Every point ever inserted, by id, and the ids still present
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  std::vector<vtkIdType> present(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->InsertNextPoint(RandomPoint(rng).data());
+    present[i] = i;
+  }
+
+  vtkNew<vtkTimerLog> timer;
+  DynamicPointLocator dynamicLocator;
+  timer->StartTimer();
+  dynamicLocator.Initialize(points);
+  timer->StopTimer();
+  std::cout << numberOfPoints << " points, dynamic locator built in "
+            << timer->GetElapsedTime() << " s" << std::endl;
+
+  // The VTK locators are rebuilt over the present points only
+  vtkNew<vtkPoints> presentPoints;
+  presentPoints->SetDataTypeToDouble();
+  vtkNew<vtkPolyData> polydata;
+  polydata->SetPoints(presentPoints);
+  vtkNew<vtkStaticPointLocator> staticLocator;
+  staticLocator->SetDataSet(polydata);
+  vtkNew<vtkKdTreePointLocator> kdTreeLocator;
+  kdTreeLocator->SetDataSet(polydata);
+
+  auto numberOfUpdated = static_cast<vtkIdType>(updatedFraction * numberOfPoints);
+  double dynamicTime = 0.0;
+  double staticTime = 0.0;
+  double kdTreeTime = 0.0;
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    // Jitter a random subset of the points, some of them drift out of the
+    // initial bounds over the frames. Insert as many new points and remove
+    // as many random ones.
+    std::vector<vtkIdType> moved(numberOfUpdated);
+    for (auto& id : moved)
+    {
+      id = present[RandomIndex(present.size(), rng)];
+      double p[3];
+      points->GetPoint(id, p);
+      for (int j = 0; j < 3; ++j)
+      {
+        p[j] += rng->GetRangeValue(-0.01, 0.02);
+        rng->Next();
+      }
+      points->SetPoint(id, p);
+    }
+    std::vector<vtkIdType> inserted(numberOfUpdated);
+    for (auto& id : inserted)
+    {
+      id = points->InsertNextPoint(RandomPoint(rng).data());
+      present.push_back(id);
+    }
+    std::vector<vtkIdType> removed(numberOfUpdated);
+    for (auto& id : removed)
+    {
+      auto index = RandomIndex(present.size(), rng);
+      id = present[index];
+      present[index] = present.back();
+      present.pop_back();
+    }
+
+    timer->StartTimer();
+    for (auto id : moved)
+    {
+      dynamicLocator.MovePoint(id, points->GetPoint(id));
+    }
+    for (auto id : inserted)
+    {
+      dynamicLocator.InsertPoint(id, points->GetPoint(id));
+    }
+    for (auto id : removed)
+    {
+      dynamicLocator.RemovePoint(id);
+    }
+    timer->StopTimer();
+    dynamicTime += timer->GetElapsedTime();
+
+    CopyPresentPoints(points, present, presentPoints);
+
+    timer->StartTimer();
+    staticLocator->BuildLocator();
+    timer->StopTimer();
+    staticTime += timer->GetElapsedTime();
+
+    timer->StartTimer();
+    kdTreeLocator->BuildLocator();
+    timer->StopTimer();
+    kdTreeTime += timer->GetElapsedTime();
+  }
+
+  // Same answers as a locator built from scratch over the present points
+  CopyPresentPoints(points, present, presentPoints);
+  staticLocator->BuildLocator();
+  int mismatches = 0;
+  vtkNew<vtkIdList> dynamicIds;
+  vtkNew<vtkIdList> staticIds;
+  for (int i = 0; i < 1000; ++i)
+  {
+    auto q = RandomPoint(rng);
+    vtkIdType closest = dynamicLocator.FindClosestPoint(q.data());
+    vtkIdType expected = staticLocator->FindClosestPoint(q.data());
+    double d1 = closest < 0
+        ? VTK_DOUBLE_MAX
+        : vtkMath::Distance2BetweenPoints(q.data(), points->GetPoint(closest));
+    double d2 = expected < 0 ? VTK_DOUBLE_MAX
+                             : vtkMath::Distance2BetweenPoints(
+                                   q.data(), presentPoints->GetPoint(expected));
+    dynamicLocator.FindPointsWithinRadius(0.02, q.data(), dynamicIds);
+    staticLocator->FindPointsWithinRadius(0.02, q.data(), staticIds);
+    if (d1 != d2 || dynamicIds->GetNumberOfIds() != staticIds->GetNumberOfIds())
+    {
+      ++mismatches;
+    }
+  }
+
+  std::cout << numberOfFrames << " frames moving, inserting and removing "
+            << numberOfUpdated << " points each, " << present.size()
+            << " points left, per frame:" << std::endl;
+  std::cout << "  dynamic locator update:        "
+            << dynamicTime / numberOfFrames << " s, "
+            << dynamicLocator.GetNumberOfRebuilds() << " rebalances"
+            << std::endl;
+  std::cout << "  vtkStaticPointLocator rebuild: " << staticTime / numberOfFrames
+            << " s (" << staticTime / dynamicTime << "x)" << std::endl;
+  std::cout << "  vtkKdTreePointLocator rebuild: " << kdTreeTime / numberOfFrames
+            << " s (" << kdTreeTime / dynamicTime << "x)" << std::endl;
+  std::cout << mismatches << " of 1000 queries differ" << std::endl;
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+void CopyPresentPoints(vtkPoints* points, std::vector<vtkIdType> const& present,
+                       vtkPoints* presentPoints)
+{
+  presentPoints->SetNumberOfPoints(static_cast<vtkIdType>(present.size()));
+  for (size_t i = 0; i < present.size(); ++i)
+  {
+    presentPoints->SetPoint(static_cast<vtkIdType>(i),
+                            points->GetPoint(present[i]));
+  }
+  presentPoints->Modified();
+}
+
+std::array<double, 3> RandomPoint(vtkMinimalStandardRandomSequence* rng)
+{
+  std::array<double, 3> p;
+  for (auto& c : p)
+  {
+    c = rng->GetRangeValue(0.0, 1.0);
+    rng->Next();
+  }
+  return p;
+}
+
+size_t RandomIndex(size_t size, vtkMinimalStandardRandomSequence* rng)
+{
+  auto index = std::min(size - 1, static_cast<size_t>(rng->GetValue() * size));
+  rng->Next();
+  return index;
+}
+
+void DynamicPointLocator::Initialize(vtkPoints* points)
+{
+  this->NumberOfPoints = points->GetNumberOfPoints();
+  this->Positions.resize(this->NumberOfPoints);
+  this->BucketOf.assign(this->NumberOfPoints, 0);
+  this->SlotOf.resize(this->NumberOfPoints);
+  for (vtkIdType i = 0; i < this->NumberOfPoints; ++i)
+  {
+    points->GetPoint(i, this->Positions[i].data());
+  }
+  this->Rebuild();
+}
+
+void DynamicPointLocator::Rebuild()
+{
+  ++this->NumberOfRebuilds;
+  this->NumberOfPointsAtBuild = this->NumberOfPoints;
+  if (this->NumberOfPoints == 0)
+  {
+    // One empty bucket, the next insertion rebuilds the grid
+    for (int j = 0; j < 3; ++j)
+    {
+      this->Bounds[2 * j] = this->Bounds[2 * j + 1] = 0.0;
+      this->H[j] = 1.0;
+      this->Divisions[j] = 1;
+    }
+    this->Buckets.assign(1, {});
+    return;
+  }
+  for (int j = 0; j < 3; ++j)
+  {
+    this->Bounds[2 * j] = VTK_DOUBLE_MAX;
+    this->Bounds[2 * j + 1] = -VTK_DOUBLE_MAX;
+  }
+  for (size_t i = 0; i < this->Positions.size(); ++i)
+  {
+    if (this->BucketOf[i] < 0)
+    {
+      continue;
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+      this->Bounds[2 * j] = std::min(this->Bounds[2 * j], this->Positions[i][j]);
+      this->Bounds[2 * j + 1] =
+          std::max(this->Bounds[2 * j + 1], this->Positions[i][j]);
+    }
+  }
+
+  // Pad the bounds so that moving points rarely leave them
+  double volume = 1.0;
+  for (int j = 0; j < 3; ++j)
+  {
+    double length = std::max(this->Bounds[2 * j + 1] - this->Bounds[2 * j], 1.0e-6);
+    this->Bounds[2 * j] -= Padding * length;
+    this->Bounds[2 * j + 1] += Padding * length;
+    volume *= this->Bounds[2 * j + 1] - this->Bounds[2 * j];
+  }
+  double numberOfBuckets =
+      std::max<double>(1.0, this->NumberOfPoints / static_cast<double>(PointsPerBucket));
+  double h = std::cbrt(volume / numberOfBuckets);
+  for (int j = 0; j < 3; ++j)
+  {
+    double length = this->Bounds[2 * j + 1] - this->Bounds[2 * j];
+    this->Divisions[j] = std::max(1, static_cast<int>(length / h));
+    this->H[j] = length / this->Divisions[j];
+  }
+
+  this->Buckets.assign(static_cast<size_t>(this->Divisions[0]) *
+                           this->Divisions[1] * this->Divisions[2],
+                       {});
+  int ijk[3];
+  for (size_t i = 0; i < this->Positions.size(); ++i)
+  {
+    if (this->BucketOf[i] >= 0)
+    {
+      this->AddToBucket(static_cast<vtkIdType>(i),
+                        this->GetBucket(this->Positions[i].data(), ijk));
+    }
+  }
+}
+
+vtkIdType DynamicPointLocator::GetBucket(const double x[3], int ijk[3]) const
+{
+  for (int j = 0; j < 3; ++j)
+  {
+    ijk[j] = static_cast<int>((x[j] - this->Bounds[2 * j]) / this->H[j]);
+    ijk[j] = std::min(std::max(ijk[j], 0), this->Divisions[j] - 1);
+  }
+  return ijk[0] +
+      static_cast<vtkIdType>(this->Divisions[0]) *
+      (ijk[1] + static_cast<vtkIdType>(this->Divisions[1]) * ijk[2]);
+}
+
+bool DynamicPointLocator::IsInside(const double x[3]) const
+{
+  for (int j = 0; j < 3; ++j)
+  {
+    if (x[j] < this->Bounds[2 * j] || x[j] > this->Bounds[2 * j + 1])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DynamicPointLocator::AddToBucket(vtkIdType id, vtkIdType bucket)
+{
+  this->BucketOf[id] = bucket;
+  this->SlotOf[id] = static_cast<vtkIdType>(this->Buckets[bucket].size());
+  this->Buckets[bucket].push_back(id);
+}
+
+// Swap with the last point of the bucket, O(1)
+void DynamicPointLocator::RemoveFromBucket(vtkIdType id)
+{
+  auto& bucket = this->Buckets[this->BucketOf[id]];
+  vtkIdType last = bucket.back();
+  bucket[this->SlotOf[id]] = last;
+  this->SlotOf[last] = this->SlotOf[id];
+  bucket.pop_back();
+  this->BucketOf[id] = -1;
+}
+
+void DynamicPointLocator::InsertPoint(vtkIdType id, const double x[3])
+{
+  if (id >= static_cast<vtkIdType>(this->Positions.size()))
+  {
+    this->Positions.resize(id + 1);
+    this->BucketOf.resize(id + 1, -1);
+    this->SlotOf.resize(id + 1);
+  }
+  if (this->BucketOf[id] >= 0)
+  {
+    this->MovePoint(id, x);
+    return;
+  }
+  std::copy(x, x + 3, this->Positions[id].data());
+  ++this->NumberOfPoints;
+  this->BucketOf[id] = 0;
+  if (!this->IsInside(x) || this->NumberOfPoints > 2 * this->NumberOfPointsAtBuild)
+  {
+    this->Rebuild();
+    return;
+  }
+  int ijk[3];
+  this->AddToBucket(id, this->GetBucket(x, ijk));
+}
+
+void DynamicPointLocator::RemovePoint(vtkIdType id)
+{
+  if (id >= static_cast<vtkIdType>(this->Positions.size()) || this->BucketOf[id] < 0)
+  {
+    return;
+  }
+  this->RemoveFromBucket(id);
+  --this->NumberOfPoints;
+  if (2 * this->NumberOfPoints < this->NumberOfPointsAtBuild)
+  {
+    this->Rebuild();
+  }
+}
+
+void DynamicPointLocator::MovePoint(vtkIdType id, const double x[3])
+{
+  if (id >= static_cast<vtkIdType>(this->Positions.size()) || this->BucketOf[id] < 0)
+  {
+    return;
+  }
+  std::copy(x, x + 3, this->Positions[id].data());
+  if (!this->IsInside(x))
+  {
+    this->Rebuild();
+    return;
+  }
+  int ijk[3];
+  vtkIdType bucket = this->GetBucket(x, ijk);
+  if (bucket != this->BucketOf[id])
+  {
+    this->RemoveFromBucket(id);
+    this->AddToBucket(id, bucket);
+  }
+}
+
+// Visits the shells of buckets around the query, nearest first, until no
+// unvisited bucket can hold a closer point.
+vtkIdType DynamicPointLocator::FindClosestPoint(const double x[3]) const
+{
+  int ijk[3];
+  this->GetBucket(x, ijk);
+  double minH = std::min({this->H[0], this->H[1], this->H[2]});
+  int maxLevel = std::max({this->Divisions[0], this->Divisions[1], this->Divisions[2]});
+
+  vtkIdType closest = -1;
+  double closestDistance2 = VTK_DOUBLE_MAX;
+  for (int level = 0; level <= maxLevel; ++level)
+  {
+    int lo[3];
+    int hi[3];
+    for (int j = 0; j < 3; ++j)
+    {
+      lo[j] = std::max(ijk[j] - level, 0);
+      hi[j] = std::min(ijk[j] + level, this->Divisions[j] - 1);
+    }
+    for (int k = lo[2]; k <= hi[2]; ++k)
+    {
+      for (int j = lo[1]; j <= hi[1]; ++j)
+      {
+        for (int i = lo[0]; i <= hi[0]; ++i)
+        {
+          if (std::max({std::abs(i - ijk[0]), std::abs(j - ijk[1]),
+                        std::abs(k - ijk[2])}) != level)
+          {
+            continue;
+          }
+          auto const& bucket = this->Buckets[i +
+              static_cast<vtkIdType>(this->Divisions[0]) *
+                  (j + static_cast<vtkIdType>(this->Divisions[1]) * k)];
+          for (auto id : bucket)
+          {
+            double distance2 =
+                vtkMath::Distance2BetweenPoints(x, this->Positions[id].data());
+            if (distance2 < closestDistance2)
+            {
+              closestDistance2 = distance2;
+              closest = id;
+            }
+          }
+        }
+      }
+    }
+    // Buckets beyond this shell are at least level * minH away
+    double reach = level * minH;
+    if (closest >= 0 && closestDistance2 <= reach * reach)
+    {
+      break;
+    }
+  }
+  return closest;
+}
+
+void DynamicPointLocator::FindPointsWithinRadius(double radius,
+                                                 const double x[3],
+                                                 vtkIdList* result) const
+{
+  result->Reset();
+  int lo[3];
+  int hi[3];
+  double corner[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    corner[j] = x[j] - radius;
+  }
+  this->GetBucket(corner, lo);
+  for (int j = 0; j < 3; ++j)
+  {
+    corner[j] = x[j] + radius;
+  }
+  this->GetBucket(corner, hi);
+
+  double radius2 = radius * radius;
+  for (int k = lo[2]; k <= hi[2]; ++k)
+  {
+    for (int j = lo[1]; j <= hi[1]; ++j)
+    {
+      for (int i = lo[0]; i <= hi[0]; ++i)
+      {
+        auto const& bucket = this->Buckets[i +
+            static_cast<vtkIdType>(this->Divisions[0]) *
+                (j + static_cast<vtkIdType>(this->Divisions[1]) * k)];
+        for (auto id : bucket)
+        {
+          if (vtkMath::Distance2BetweenPoints(x, this->Positions[id].data()) <=
+              radius2)
+          {
+            result->InsertNextId(id);
+          }
+        }
+      }
+    }
+  }
+}
+} // namespace
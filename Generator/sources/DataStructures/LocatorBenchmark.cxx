@@ -0,0 +1,372 @@
+#include <vtkAbstractCellLocator.h>
+#include <vtkAbstractPointLocator.h>
+#include <vtkCellArray.h>
+#include <vtkCellLocator.h>
+#include <vtkCellTreeLocator.h>
+#include <vtkIdList.h>
+#include <vtkKdTreePointLocator.h>
+#include <vtkMath.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkModifiedBSPTree.h>
+#include <vtkNew.h>
+#include <vtkOBBTree.h>
+#include <vtkOctreePointLocator.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+struct Result
+{
+  std::string Locator;
+  vtkIdType NumberOfPoints;
+  vtkIdType NumberOfCells;
+  std::string Query;
+  double BuildTime;
+  int NumberOfQueries;
+  double QueryTime;
+};
+
+using Point = std::array<double, 3>;
+
+// The radius of the spheres
+const double SphereRadius = 0.5;
+
+// A triangulated sphere of about numberOfPoints points. vtkSphereSource
+// clamps its resolutions to 1024, about 1e6 points, so it is built here.
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfPoints);
+
+std::vector<Point> RandomPointsInBounds(vtkPolyData* polydata, int numberOfPoints,
+                                        vtkMinimalStandardRandomSequence* rng);
+
+std::vector<Point> RandomPointsOnSphere(int numberOfPoints,
+                                        vtkMinimalStandardRandomSequence* rng);
+
+// Point queries are on the surface, segments join points of the bounds.
+void TimePointLocator(vtkAbstractPointLocator* prototype, vtkPolyData* polydata,
+                      std::vector<Point> const& queries,
+                      std::vector<Result>& results);
+
+void TimeCellLocator(vtkAbstractCellLocator* prototype, vtkPolyData* polydata,
+                     std::vector<Point> const& queries,
+                     std::vector<Point> const& segments,
+                     std::vector<Result>& results);
+
+void WriteCSV(std::ostream& stream, std::vector<Result> const& results);
+
+void WriteJSON(std::ostream& stream, std::vector<Result> const& results);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: LocatorBenchmark [max number of points] [number of queries] [output prefix]
+  vtkIdType maxNumberOfPoints = 10000000;
+  int numberOfQueries = 10000;
+  std::string prefix;
+  if (argc > 1)
+  {
+    maxNumberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfQueries = std::atoi(argv[2]);
+  }
+  if (argc > 3)
+  {
+    prefix = argv[3];
+  }
+
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+
+  std::vector<vtkSmartPointer<vtkAbstractPointLocator>> pointLocators = {
+      vtkSmartPointer<vtkKdTreePointLocator>::New(),
+      vtkSmartPointer<vtkOctreePointLocator>::New(),
+      vtkSmartPointer<vtkStaticPointLocator>::New()};
+  std::vector<vtkSmartPointer<vtkAbstractCellLocator>> cellLocators = {
+      vtkSmartPointer<vtkCellLocator>::New(),
+      vtkSmartPointer<vtkCellTreeLocator>::New(),
+      vtkSmartPointer<vtkOBBTree>::New(),
+      vtkSmartPointer<vtkModifiedBSPTree>::New()};
+
+  std::vector<Result> results;
+  for (vtkIdType numberOfPoints = 1000; numberOfPoints <= maxNumberOfPoints;
+       numberOfPoints *= 10)
+  {
+    auto polydata = MakeSphere(numberOfPoints);
+    auto queries = RandomPointsOnSphere(numberOfQueries, rng);
+    auto segments = RandomPointsInBounds(polydata, numberOfQueries, rng);
+    std::cout << "Timing " << polydata->GetNumberOfPoints() << " points, "
+              << polydata->GetNumberOfCells() << " cells..." << std::endl;
+    for (auto& locator : pointLocators)
+    {
+      TimePointLocator(locator, polydata, queries, results);
+    }
+    for (auto& locator : cellLocators)
+    {
+      TimeCellLocator(locator, polydata, queries, segments, results);
+    }
+  }
+
+  WriteCSV(std::cout, results);
+  if (!prefix.empty())
+  {
+    std::ofstream csv(prefix + ".csv");
+    WriteCSV(csv, results);
+    std::ofstream json(prefix + ".json");
+    WriteJSON(json, results);
+    std::cout << "Wrote " << prefix << ".csv and " << prefix << ".json"
+              << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfPoints)
+{
+  // r rings of r points between the poles, as vtkSphereSource does
+  auto resolution = std::max<vtkIdType>(
+      3, static_cast<vtkIdType>(std::sqrt(static_cast<double>(numberOfPoints))));
+  auto pointId = [resolution](vtkIdType ring, vtkIdType segment) {
+    return 2 + ring * resolution + segment % resolution;
+  };
+
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(resolution * resolution + 2);
+  points->SetPoint(0, 0.0, 0.0, SphereRadius);
+  points->SetPoint(1, 0.0, 0.0, -SphereRadius);
+  for (vtkIdType i = 0; i < resolution; ++i)
+  {
+    double phi = vtkMath::Pi() * (i + 1) / (resolution + 1);
+    for (vtkIdType j = 0; j < resolution; ++j)
+    {
+      double theta = 2.0 * vtkMath::Pi() * j / resolution;
+      points->SetPoint(pointId(i, j),
+                       SphereRadius * std::sin(phi) * std::cos(theta),
+                       SphereRadius * std::sin(phi) * std::sin(theta),
+                       SphereRadius * std::cos(phi));
+    }
+  }
+
+  vtkNew<vtkCellArray> polys;
+  polys->AllocateExact(2 * resolution * resolution,
+                       6 * resolution * resolution);
+  for (vtkIdType j = 0; j < resolution; ++j)
+  {
+    vtkIdType north[3] = {0, pointId(0, j), pointId(0, j + 1)};
+    polys->InsertNextCell(3, north);
+    vtkIdType south[3] = {1, pointId(resolution - 1, j + 1),
+                          pointId(resolution - 1, j)};
+    polys->InsertNextCell(3, south);
+  }
+  for (vtkIdType i = 0; i + 1 < resolution; ++i)
+  {
+    for (vtkIdType j = 0; j < resolution; ++j)
+    {
+      vtkIdType lower[3] = {pointId(i, j), pointId(i + 1, j),
+                            pointId(i + 1, j + 1)};
+      polys->InsertNextCell(3, lower);
+      vtkIdType upper[3] = {pointId(i, j), pointId(i + 1, j + 1),
+                            pointId(i, j + 1)};
+      polys->InsertNextCell(3, upper);
+    }
+  }
+
+  auto polydata = vtkSmartPointer<vtkPolyData>::New();
+  polydata->SetPoints(points);
+  polydata->SetPolys(polys);
+  return polydata;
+}
+
+std::vector<Point> RandomPointsInBounds(vtkPolyData* polydata, int numberOfPoints,
+                                        vtkMinimalStandardRandomSequence* rng)
+{
+  double bounds[6];
+  polydata->GetBounds(bounds);
+
+  std::vector<Point> points(numberOfPoints);
+  for (auto& p : points)
+  {
+    for (auto i = 0; i < 3; ++i)
+    {
+      p[i] = bounds[i * 2] +
+          (bounds[i * 2 + 1] - bounds[i * 2]) * rng->GetRangeValue(0.0, 1.0);
+      rng->Next();
+    }
+  }
+  return points;
+}
+
+std::vector<Point> RandomPointsOnSphere(int numberOfPoints,
+                                        vtkMinimalStandardRandomSequence* rng)
+{
+  // Uniform on the sphere: z uniform in [-r, r], the angle uniform
+  std::vector<Point> points(numberOfPoints);
+  for (auto& p : points)
+  {
+    double z = rng->GetRangeValue(-1.0, 1.0);
+    rng->Next();
+    double theta = rng->GetRangeValue(0.0, 2.0 * vtkMath::Pi());
+    rng->Next();
+    double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+    p = {SphereRadius * r * std::cos(theta), SphereRadius * r * std::sin(theta),
+         SphereRadius * z};
+  }
+  return points;
+}
+
+// Build once, then time every query kind separately against the same tree.
+void TimePointLocator(vtkAbstractPointLocator* prototype, vtkPolyData* polydata,
+                      std::vector<Point> const& queries,
+                      std::vector<Result>& results)
+{
+  auto locator = vtkSmartPointer<vtkAbstractPointLocator>::Take(
+      prototype->NewInstance());
+  vtkNew<vtkTimerLog> timer;
+
+  timer->StartTimer();
+  locator->SetDataSet(polydata);
+  locator->BuildLocator();
+  timer->StopTimer();
+  double buildTime = timer->GetElapsedTime();
+
+  // The N points cover a sphere of area 4 pi R^2, a query on the surface finds
+  // about k of them within the radius.
+  const int k = 8;
+  double radius = 2.0 * SphereRadius *
+      std::sqrt(k / static_cast<double>(polydata->GetNumberOfPoints()));
+  vtkNew<vtkIdList> ids;
+
+  auto numberOfQueries = static_cast<int>(queries.size());
+  Result result{locator->GetClassName(), polydata->GetNumberOfPoints(),
+                polydata->GetNumberOfCells(), "", buildTime, numberOfQueries, 0.0};
+
+  result.Query = "closest_point";
+  timer->StartTimer();
+  for (auto const& p : queries)
+  {
+    locator->FindClosestPoint(p.data());
+  }
+  timer->StopTimer();
+  result.QueryTime = timer->GetElapsedTime();
+  results.push_back(result);
+
+  result.Query = "within_radius";
+  timer->StartTimer();
+  for (auto const& p : queries)
+  {
+    locator->FindPointsWithinRadius(radius, p.data(), ids);
+  }
+  timer->StopTimer();
+  result.QueryTime = timer->GetElapsedTime();
+  results.push_back(result);
+
+  result.Query = "k_nearest";
+  timer->StartTimer();
+  for (auto const& p : queries)
+  {
+    locator->FindClosestNPoints(k, p.data(), ids);
+  }
+  timer->StopTimer();
+  result.QueryTime = timer->GetElapsedTime();
+  results.push_back(result);
+}
+
+void TimeCellLocator(vtkAbstractCellLocator* prototype, vtkPolyData* polydata,
+                     std::vector<Point> const& queries,
+                     std::vector<Point> const& segments,
+                     std::vector<Result>& results)
+{
+  auto locator = vtkSmartPointer<vtkAbstractCellLocator>::Take(
+      prototype->NewInstance());
+  vtkNew<vtkTimerLog> timer;
+
+  timer->StartTimer();
+  locator->SetDataSet(polydata);
+  locator->BuildLocator();
+  timer->StopTimer();
+  double buildTime = timer->GetElapsedTime();
+
+  auto numberOfQueries = static_cast<int>(queries.size());
+  Result result{locator->GetClassName(), polydata->GetNumberOfPoints(),
+                polydata->GetNumberOfCells(), "", buildTime, numberOfQueries, 0.0};
+
+  double closest[3];
+  double x[3];
+  double pcoords[3];
+  double t;
+  double dist2;
+  vtkIdType cellId;
+  int subId;
+
+  // Only vtkCellLocator implements FindClosestPoint.
+  if (locator->IsA("vtkCellLocator"))
+  {
+    result.Query = "closest_point";
+    timer->StartTimer();
+    for (auto const& p : queries)
+    {
+      locator->FindClosestPoint(p.data(), closest, cellId, subId, dist2);
+    }
+    timer->StopTimer();
+    result.QueryTime = timer->GetElapsedTime();
+    results.push_back(result);
+  }
+
+  // Segments between consecutive points of the bounds, most of them cross
+  // the sphere.
+  result.Query = "line_intersection";
+  timer->StartTimer();
+  for (size_t i = 0; i < segments.size(); ++i)
+  {
+    auto const& p2 = segments[(i + 1) % segments.size()];
+    locator->IntersectWithLine(segments[i].data(), p2.data(), 0.001, t, x,
+                               pcoords, subId, cellId);
+  }
+  timer->StopTimer();
+  result.QueryTime = timer->GetElapsedTime();
+  results.push_back(result);
+}
+
+void WriteCSV(std::ostream& stream, std::vector<Result> const& results)
+{
+  stream << "locator,points,cells,query,build_s,queries,query_s,us_per_query"
+         << std::endl;
+  for (auto const& r : results)
+  {
+    stream << r.Locator << "," << r.NumberOfPoints << "," << r.NumberOfCells
+           << "," << r.Query << "," << r.BuildTime << "," << r.NumberOfQueries
+           << "," << r.QueryTime << ","
+           << 1.0e6 * r.QueryTime / r.NumberOfQueries << std::endl;
+  }
+}
+
+void WriteJSON(std::ostream& stream, std::vector<Result> const& results)
+{
+  stream << "[" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    auto const& r = results[i];
+    stream << "  {\"locator\": \"" << r.Locator
+           << "\", \"points\": " << r.NumberOfPoints
+           << ", \"cells\": " << r.NumberOfCells << ", \"query\": \""
+           << r.Query << "\", \"build_s\": " << r.BuildTime
+           << ", \"queries\": " << r.NumberOfQueries
+           << ", \"query_s\": " << r.QueryTime << "}"
+           << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  stream << "]" << std::endl;
+}
+} // namespace
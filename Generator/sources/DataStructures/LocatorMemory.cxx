@@ -0,0 +1,469 @@
+#include <vtkAbstractCellLocator.h>
+#include <vtkAbstractPointLocator.h>
+#include <vtkCellLocator.h>
+#include <vtkCellTreeLocator.h>
+#include <vtkKdTreePointLocator.h>
+#include <vtkMath.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkModifiedBSPTree.h>
+#include <vtkNew.h>
+#include <vtkOBBTree.h>
+#include <vtkOctreePointLocator.h>
+#include <vtkPointLocator.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+// Bytes in use on the heap, 0 where the allocator cannot tell
+std::size_t HeapInUse();
+
+// Growth of the heap since before
+std::size_t HeapGrowth(std::size_t before);
+
+// Kd-tree in flat arrays. The tree is complete: the children of node i are
+// 2i + 1 and 2i + 2, and every node splits its range of points at the
+// middle, so the ranges follow from the indices and are not stored. A node
+// is a split value and an axis; the points are copied in tree order as float
+// next to their 32 bit ids.
+class CompactKdTree
+{
+public:
+  // False if the point ids do not fit in 32 bits
+  bool Build(vtkPoints* points, int leafSize);
+
+  vtkIdType FindClosestPoint(const double x[3]) const;
+
+  std::size_t GetActualMemorySize() const;
+
+  void PrintMemory(std::ostream& os) const;
+
+private:
+  void Split(int node, std::int32_t begin, std::int32_t end, int level,
+             std::vector<std::array<float, 3>> const& points);
+
+  void FindClosestPoint(int node, std::int32_t begin, std::int32_t end,
+                        int level, const float x[3], std::int32_t& closest,
+                        float& closestDistance2) const;
+
+  int Depth = 0;
+  std::vector<float> Splits;
+  std::vector<std::uint8_t> Axes;
+  std::vector<std::array<float, 3>> Points;
+  std::vector<std::int32_t> Ids;
+};
+
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfPoints);
+
+std::vector<std::array<double, 3>>
+RandomPointsInBounds(vtkPolyData* polydata, int numberOfPoints,
+                     vtkMinimalStandardRandomSequence* rng);
+
+void PrintRow(std::string const& name, double buildTime, std::size_t bytes,
+              vtkIdType numberOfPoints, std::string const& query,
+              double queryTime);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: LocatorMemory [number of points] [number of queries]
+  vtkIdType numberOfPoints = 1000000;
+  int numberOfQueries = 100000;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfQueries = std::atoi(argv[2]);
+  }
+  if (numberOfPoints > 1024 * 1024)
+  {
+    std::cout << "vtkSphereSource makes at most " << 1024 * 1024
+              << " points" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto polydata = MakeSphere(numberOfPoints);
+  numberOfPoints = polydata->GetNumberOfPoints();
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  auto queries = RandomPointsInBounds(polydata, numberOfQueries, rng);
+  // Build the cells now, so that the first cell locator is not charged for it
+  polydata->BuildCells();
+
+  std::cout << numberOfPoints << " points, " << polydata->GetNumberOfCells()
+            << " cells, " << numberOfQueries << " queries" << std::endl;
+  if (HeapInUse() == 0)
+  {
+    std::cout << "The heap usage is not available on this platform, bytes are"
+                 " only reported for the compact kd-tree."
+              << std::endl;
+  }
+  std::cout << "locator,build_s,bytes,bytes_per_point,query,query_s"
+            << std::endl;
+
+  vtkNew<vtkTimerLog> timer;
+  // The closest points of the compact kd-tree are checked against this one
+  auto reference = vtkSmartPointer<vtkStaticPointLocator>::New();
+  std::vector<vtkSmartPointer<vtkAbstractPointLocator>> pointLocators = {
+      vtkSmartPointer<vtkKdTreePointLocator>::New(),
+      vtkSmartPointer<vtkOctreePointLocator>::New(),
+      vtkSmartPointer<vtkPointLocator>::New(), reference};
+  std::vector<vtkIdType> found(numberOfQueries);
+  std::vector<vtkIdType> expected;
+  for (auto& locator : pointLocators)
+  {
+    locator->SetDataSet(polydata);
+    std::size_t before = HeapInUse();
+    timer->StartTimer();
+    locator->BuildLocator();
+    timer->StopTimer();
+    double buildTime = timer->GetElapsedTime();
+    std::size_t bytes = HeapGrowth(before);
+
+    timer->StartTimer();
+    for (int i = 0; i < numberOfQueries; ++i)
+    {
+      found[i] = locator->FindClosestPoint(queries[i].data());
+    }
+    timer->StopTimer();
+    PrintRow(locator->GetClassName(), buildTime, bytes, numberOfPoints,
+             "closest_point", timer->GetElapsedTime());
+    if (locator == reference)
+    {
+      expected = found;
+    }
+    // Release the memory before measuring the next one
+    locator->FreeSearchStructure();
+  }
+
+  std::vector<vtkSmartPointer<vtkAbstractCellLocator>> cellLocators = {
+      vtkSmartPointer<vtkCellLocator>::New(),
+      vtkSmartPointer<vtkCellTreeLocator>::New(),
+      vtkSmartPointer<vtkOBBTree>::New(),
+      vtkSmartPointer<vtkModifiedBSPTree>::New()};
+  for (auto& locator : cellLocators)
+  {
+    locator->SetDataSet(polydata);
+    std::size_t before = HeapInUse();
+    timer->StartTimer();
+    locator->BuildLocator();
+    timer->StopTimer();
+    double buildTime = timer->GetElapsedTime();
+    std::size_t bytes = HeapGrowth(before);
+
+    // Segments between consecutive queries, most of them cross the sphere
+    double t;
+    double x[3];
+    double pcoords[3];
+    int subId;
+    vtkIdType cellId;
+    timer->StartTimer();
+    for (int i = 0; i < numberOfQueries; ++i)
+    {
+      auto const& p2 = queries[(i + 1) % numberOfQueries];
+      locator->IntersectWithLine(queries[i].data(), p2.data(), 0.001, t, x,
+                                 pcoords, subId, cellId);
+    }
+    timer->StopTimer();
+    PrintRow(locator->GetClassName(), buildTime, bytes, numberOfPoints,
+             "line_intersection", timer->GetElapsedTime());
+    locator->FreeSearchStructure();
+  }
+
+  CompactKdTree tree;
+  std::size_t before = HeapInUse();
+  timer->StartTimer();
+  if (!tree.Build(polydata->GetPoints(), 8))
+  {
+    std::cout << "Too many points for 32 bit ids" << std::endl;
+    return EXIT_FAILURE;
+  }
+  timer->StopTimer();
+  double buildTime = timer->GetElapsedTime();
+  std::size_t bytes = HeapGrowth(before);
+
+  std::vector<vtkIdType> closest(numberOfQueries);
+  timer->StartTimer();
+  for (int i = 0; i < numberOfQueries; ++i)
+  {
+    closest[i] = tree.FindClosestPoint(queries[i].data());
+  }
+  timer->StopTimer();
+  PrintRow("CompactKdTree", buildTime, bytes ? bytes : tree.GetActualMemorySize(),
+           numberOfPoints, "closest_point", timer->GetElapsedTime());
+
+  std::cout << std::endl;
+  tree.PrintMemory(std::cout);
+
+  // Same answers as the reference, up to the float coordinates
+  int mismatches = 0;
+  for (int i = 0; i < numberOfQueries; ++i)
+  {
+    double d = vtkMath::Distance2BetweenPoints(queries[i].data(),
+                                               polydata->GetPoint(closest[i]));
+    double e = vtkMath::Distance2BetweenPoints(
+        queries[i].data(), polydata->GetPoint(expected[i]));
+    if (d - e > 1.0e-6 * (1.0 + e))
+    {
+      ++mismatches;
+    }
+  }
+  std::cout << mismatches << " mismatches" << std::endl;
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+std::size_t HeapInUse()
+{
+#if defined(__EMSCRIPTEN__)
+  return static_cast<std::size_t>(static_cast<unsigned int>(mallinfo().uordblks));
+#elif defined(__GLIBC__) &&                                                    \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  // Large blocks are mapped apart (hblkhd)
+  auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+std::size_t HeapGrowth(std::size_t before)
+{
+  std::size_t after = HeapInUse();
+  return after > before ? after - before : 0;
+}
+
+bool CompactKdTree::Build(vtkPoints* points, int leafSize)
+{
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  if (numberOfPoints > std::numeric_limits<std::int32_t>::max())
+  {
+    return false;
+  }
+  auto n = static_cast<std::int32_t>(numberOfPoints);
+
+  std::vector<std::array<float, 3>> original(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    double p[3];
+    points->GetPoint(i, p);
+    original[i] = {static_cast<float>(p[0]), static_cast<float>(p[1]),
+                   static_cast<float>(p[2])};
+  }
+
+  // Halve until the leaves hold at most leafSize points
+  this->Depth = 0;
+  while ((static_cast<std::int64_t>(n) >> this->Depth) > leafSize)
+  {
+    ++this->Depth;
+  }
+  std::size_t numberOfNodes = (std::size_t(1) << this->Depth) - 1;
+  this->Splits.assign(numberOfNodes, 0.0f);
+  this->Axes.assign(numberOfNodes, 0);
+  this->Ids.resize(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    this->Ids[i] = i;
+  }
+  this->Split(0, 0, n, 0, original);
+
+  this->Points.resize(n);
+  for (std::int32_t i = 0; i < n; ++i)
+  {
+    this->Points[i] = original[this->Ids[i]];
+  }
+  return true;
+}
+
+void CompactKdTree::Split(int node, std::int32_t begin, std::int32_t end,
+                          int level,
+                          std::vector<std::array<float, 3>> const& points)
+{
+  if (level == this->Depth)
+  {
+    return;
+  }
+
+  // Split the axis of largest extent
+  float lo[3] = {std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max()};
+  float hi[3] = {std::numeric_limits<float>::lowest(),
+                 std::numeric_limits<float>::lowest(),
+                 std::numeric_limits<float>::lowest()};
+  for (std::int32_t i = begin; i < end; ++i)
+  {
+    auto const& p = points[this->Ids[i]];
+    for (int j = 0; j < 3; ++j)
+    {
+      lo[j] = std::min(lo[j], p[j]);
+      hi[j] = std::max(hi[j], p[j]);
+    }
+  }
+  int axis = 0;
+  for (int j = 1; j < 3; ++j)
+  {
+    if (hi[j] - lo[j] > hi[axis] - lo[axis])
+    {
+      axis = j;
+    }
+  }
+
+  std::int32_t middle = begin + (end - begin) / 2;
+  std::nth_element(this->Ids.begin() + begin, this->Ids.begin() + middle,
+                   this->Ids.begin() + end,
+                   [&](std::int32_t a, std::int32_t b) {
+                     return points[a][axis] < points[b][axis];
+                   });
+  this->Splits[node] = points[this->Ids[middle]][axis];
+  this->Axes[node] = static_cast<std::uint8_t>(axis);
+
+  this->Split(2 * node + 1, begin, middle, level + 1, points);
+  this->Split(2 * node + 2, middle, end, level + 1, points);
+}
+
+vtkIdType CompactKdTree::FindClosestPoint(const double x[3]) const
+{
+  if (this->Ids.empty())
+  {
+    return -1;
+  }
+  const float q[3] = {static_cast<float>(x[0]), static_cast<float>(x[1]),
+                      static_cast<float>(x[2])};
+  std::int32_t closest = -1;
+  float closestDistance2 = std::numeric_limits<float>::max();
+  this->FindClosestPoint(0, 0, static_cast<std::int32_t>(this->Ids.size()), 0,
+                         q, closest, closestDistance2);
+  return this->Ids[closest];
+}
+
+void CompactKdTree::FindClosestPoint(int node, std::int32_t begin,
+                                     std::int32_t end, int level,
+                                     const float x[3], std::int32_t& closest,
+                                     float& closestDistance2) const
+{
+  if (level == this->Depth)
+  {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      auto const& p = this->Points[i];
+      float dx = p[0] - x[0];
+      float dy = p[1] - x[1];
+      float dz = p[2] - x[2];
+      float distance2 = dx * dx + dy * dy + dz * dz;
+      if (distance2 < closestDistance2)
+      {
+        closestDistance2 = distance2;
+        closest = i;
+      }
+    }
+    return;
+  }
+
+  std::int32_t middle = begin + (end - begin) / 2;
+  float d = x[this->Axes[node]] - this->Splits[node];
+  if (d < 0.0f)
+  {
+    this->FindClosestPoint(2 * node + 1, begin, middle, level + 1, x, closest,
+                           closestDistance2);
+    if (d * d < closestDistance2)
+    {
+      this->FindClosestPoint(2 * node + 2, middle, end, level + 1, x, closest,
+                             closestDistance2);
+    }
+  }
+  else
+  {
+    this->FindClosestPoint(2 * node + 2, middle, end, level + 1, x, closest,
+                           closestDistance2);
+    if (d * d < closestDistance2)
+    {
+      this->FindClosestPoint(2 * node + 1, begin, middle, level + 1, x,
+                             closest, closestDistance2);
+    }
+  }
+}
+
+std::size_t CompactKdTree::GetActualMemorySize() const
+{
+  return this->Splits.capacity() * sizeof(float) +
+      this->Axes.capacity() * sizeof(std::uint8_t) +
+      this->Points.capacity() * sizeof(std::array<float, 3>) +
+      this->Ids.capacity() * sizeof(std::int32_t);
+}
+
+void CompactKdTree::PrintMemory(std::ostream& os) const
+{
+  auto n = static_cast<double>(std::max<std::size_t>(1, this->Ids.size()));
+  auto row = [&](const char* name, std::size_t bytes) {
+    os << name << "," << bytes << "," << bytes / n << std::endl;
+  };
+  os << "CompactKdTree array,bytes,bytes_per_point" << std::endl;
+  row("splits", this->Splits.capacity() * sizeof(float));
+  row("axes", this->Axes.capacity() * sizeof(std::uint8_t));
+  row("points", this->Points.capacity() * sizeof(std::array<float, 3>));
+  row("ids", this->Ids.capacity() * sizeof(std::int32_t));
+  row("total", this->GetActualMemorySize());
+}
+
+vtkSmartPointer<vtkPolyData> MakeSphere(vtkIdType numberOfPoints)
+{
+  // A sphere of resolution r x r has about r * r points.
+  auto resolution = static_cast<int>(std::sqrt(static_cast<double>(numberOfPoints)));
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(resolution);
+  sphere->SetPhiResolution(resolution);
+  sphere->Update();
+  return sphere->GetOutput();
+}
+
+std::vector<std::array<double, 3>>
+RandomPointsInBounds(vtkPolyData* polydata, int numberOfPoints,
+                     vtkMinimalStandardRandomSequence* rng)
+{
+  double bounds[6];
+  polydata->GetBounds(bounds);
+
+  std::vector<std::array<double, 3>> points(numberOfPoints);
+  for (auto& p : points)
+  {
+    for (auto i = 0; i < 3; ++i)
+    {
+      p[i] = bounds[i * 2] +
+          (bounds[i * 2 + 1] - bounds[i * 2]) * rng->GetRangeValue(0.0, 1.0);
+      rng->Next();
+    }
+  }
+  return points;
+}
+
+void PrintRow(std::string const& name, double buildTime, std::size_t bytes,
+              vtkIdType numberOfPoints, std::string const& query,
+              double queryTime)
+{
+  std::cout << name << "," << buildTime << "," << bytes << ","
+            << static_cast<double>(bytes) / numberOfPoints << "," << query
+            << "," << queryTime << std::endl;
+}
+} // namespace
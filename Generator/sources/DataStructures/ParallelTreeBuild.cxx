@@ -0,0 +1,496 @@
+#include <vtkKdTreePointLocator.h>
+#include <vtkMath.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkOctreePointLocator.h>
+#include <vtkPointSource.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace {
+using Point = std::array<float, 3>;
+
+// Kd-tree in flat arrays, as in LocatorMemory: node i has children 2i + 1
+// and 2i + 2 and splits its points at the middle. The build goes one level
+// at a time, the nodes of a level are split in parallel.
+class ParallelKdTree
+{
+public:
+  void Build(vtkPoints* points, int leafSize);
+
+  vtkIdType FindClosestPoint(const double x[3]) const;
+
+private:
+  void FindClosestPoint(int node, std::int32_t begin, std::int32_t end,
+                        int level, const float x[3], std::int32_t& closest,
+                        float& closestDistance2) const;
+
+  int Depth = 0;
+  std::vector<float> Splits;
+  std::vector<std::uint8_t> Axes;
+  std::vector<Point> Points;
+  std::vector<std::int32_t> Ids;
+};
+
+// Linear octree: the points are sorted along a Morton curve in parallel, then
+// every octant is a contiguous range of the sorted points, found by binary
+// search on the codes.
+class MortonOctree
+{
+public:
+  void Build(vtkPoints* points, int leafSize);
+
+  vtkIdType FindClosestPoint(const double x[3]) const;
+
+private:
+  struct Node
+  {
+    float Lo[3];
+    float Size;
+    // Points Begin ... End - 1, children FirstChild ... FirstChild + 7
+    // or -1 for a leaf
+    std::int32_t Begin;
+    std::int32_t End;
+    std::int32_t FirstChild;
+  };
+
+  void FindClosestPoint(std::int32_t node, const float x[3],
+                        std::int32_t& closest, float& closestDistance2) const;
+
+  std::vector<Node> Nodes;
+  std::vector<Point> Points;
+  std::vector<std::int32_t> Ids;
+};
+
+// Copies the points as float, in parallel
+std::vector<Point> ToFloat(vtkPoints* points);
+
+float Distance2(Point const& p, const float x[3]);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: ParallelTreeBuild [number of points] [number of queries]
+  vtkIdType numberOfPoints = 1000000;
+  int numberOfQueries = 10000;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    numberOfQueries = std::atoi(argv[2]);
+  }
+
+  vtkNew<vtkPointSource> pointSource;
+  pointSource->SetNumberOfPoints(numberOfPoints);
+  pointSource->SetRadius(1.0);
+  pointSource->Update();
+  auto polydata = pointSource->GetOutput();
+  auto points = polydata->GetPoints();
+
+  int maxThreads = vtkSMPTools::GetEstimatedNumberOfThreads();
+  std::cout << vtkSMPTools::GetBackend() << " backend, up to " << maxThreads
+            << " threads, " << numberOfPoints << " points" << std::endl;
+
+  // The existing builders
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkKdTreePointLocator> kdTreeLocator;
+  kdTreeLocator->SetDataSet(polydata);
+  timer->StartTimer();
+  kdTreeLocator->BuildLocator();
+  timer->StopTimer();
+  double kdTreeTime = timer->GetElapsedTime();
+
+  vtkNew<vtkOctreePointLocator> octreeLocator;
+  octreeLocator->SetDataSet(polydata);
+  timer->StartTimer();
+  octreeLocator->BuildLocator();
+  timer->StopTimer();
+  double octreeTime = timer->GetElapsedTime();
+
+  std::cout << "vtkKdTreePointLocator: " << kdTreeTime
+            << " s, vtkOctreePointLocator: " << octreeTime << " s" << std::endl;
+  std::cout << "threads,kd_tree_s,kd_tree_speedup,octree_s,octree_speedup"
+            << std::endl;
+
+  ParallelKdTree kdTree;
+  MortonOctree octree;
+  for (int threads = 1;; threads = std::min(2 * threads, maxThreads))
+  {
+    vtkSMPTools::Initialize(threads);
+
+    timer->StartTimer();
+    kdTree.Build(points, 8);
+    timer->StopTimer();
+    double kdTime = timer->GetElapsedTime();
+
+    timer->StartTimer();
+    octree.Build(points, 32);
+    timer->StopTimer();
+    double ocTime = timer->GetElapsedTime();
+
+    std::cout << threads << "," << kdTime << "," << kdTreeTime / kdTime << ","
+              << ocTime << "," << octreeTime / ocTime << std::endl;
+    if (threads == maxThreads)
+    {
+      break;
+    }
+  }
+
+  // The trees answer like the VTK locators, up to the float coordinates
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  int mismatches = 0;
+  for (int i = 0; i < numberOfQueries; ++i)
+  {
+    double x[3];
+    for (int j = 0; j < 3; ++j)
+    {
+      x[j] = rng->GetRangeValue(-1.1, 1.1);
+      rng->Next();
+    }
+    double expected = vtkMath::Distance2BetweenPoints(
+        x, points->GetPoint(kdTreeLocator->FindClosestPoint(x)));
+    for (vtkIdType id : {kdTree.FindClosestPoint(x), octree.FindClosestPoint(x)})
+    {
+      double distance2 = vtkMath::Distance2BetweenPoints(x, points->GetPoint(id));
+      if (distance2 - expected > 1.0e-6 * (1.0 + expected))
+      {
+        ++mismatches;
+      }
+    }
+  }
+  std::cout << numberOfQueries << " queries, " << mismatches << " mismatches"
+            << std::endl;
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+std::vector<Point> ToFloat(vtkPoints* points)
+{
+  std::vector<Point> result(points->GetNumberOfPoints());
+  vtkSMPTools::For(0, points->GetNumberOfPoints(),
+                   [&](vtkIdType begin, vtkIdType end) {
+                     double p[3];
+                     for (vtkIdType i = begin; i < end; ++i)
+                     {
+                       points->GetPoint(i, p);
+                       result[i] = {static_cast<float>(p[0]),
+                                    static_cast<float>(p[1]),
+                                    static_cast<float>(p[2])};
+                     }
+                   });
+  return result;
+}
+
+float Distance2(Point const& p, const float x[3])
+{
+  float dx = p[0] - x[0];
+  float dy = p[1] - x[1];
+  float dz = p[2] - x[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+void ParallelKdTree::Build(vtkPoints* points, int leafSize)
+{
+  auto original = ToFloat(points);
+  auto n = static_cast<std::int32_t>(original.size());
+
+  this->Depth = 0;
+  while ((static_cast<std::int64_t>(n) >> this->Depth) > leafSize)
+  {
+    ++this->Depth;
+  }
+  this->Splits.assign((std::size_t(1) << this->Depth) - 1, 0.0f);
+  this->Axes.assign(this->Splits.size(), 0);
+  this->Ids.resize(n);
+  vtkSMPTools::For(0, n, [&](std::int32_t begin, std::int32_t end) {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      this->Ids[i] = i;
+    }
+  });
+
+  // The nodes of a level own disjoint ranges of Ids: ranges[k] ...
+  // ranges[k + 1] - 1 for the k-th node of the level.
+  std::vector<std::int32_t> ranges = {0, n};
+  for (int level = 0; level < this->Depth; ++level)
+  {
+    auto count = static_cast<std::int32_t>(ranges.size()) - 1;
+    std::int32_t first = count - 1;
+    std::vector<std::int32_t> next(2 * count + 1);
+    vtkSMPTools::For(0, count, 1, [&](std::int32_t beginNode, std::int32_t endNode) {
+      for (std::int32_t k = beginNode; k < endNode; ++k)
+      {
+        std::int32_t begin = ranges[k];
+        std::int32_t end = ranges[k + 1];
+        float lo[3] = {std::numeric_limits<float>::max(),
+                       std::numeric_limits<float>::max(),
+                       std::numeric_limits<float>::max()};
+        float hi[3] = {std::numeric_limits<float>::lowest(),
+                       std::numeric_limits<float>::lowest(),
+                       std::numeric_limits<float>::lowest()};
+        for (std::int32_t i = begin; i < end; ++i)
+        {
+          auto const& p = original[this->Ids[i]];
+          for (int j = 0; j < 3; ++j)
+          {
+            lo[j] = std::min(lo[j], p[j]);
+            hi[j] = std::max(hi[j], p[j]);
+          }
+        }
+        int axis = 0;
+        for (int j = 1; j < 3; ++j)
+        {
+          if (hi[j] - lo[j] > hi[axis] - lo[axis])
+          {
+            axis = j;
+          }
+        }
+
+        std::int32_t middle = begin + (end - begin) / 2;
+        std::nth_element(this->Ids.begin() + begin, this->Ids.begin() + middle,
+                         this->Ids.begin() + end,
+                         [&](std::int32_t a, std::int32_t b) {
+                           return original[a][axis] < original[b][axis];
+                         });
+        this->Splits[first + k] = original[this->Ids[middle]][axis];
+        this->Axes[first + k] = static_cast<std::uint8_t>(axis);
+        next[2 * k] = begin;
+        next[2 * k + 1] = middle;
+      }
+    });
+    next[2 * count] = n;
+    ranges = std::move(next);
+  }
+
+  this->Points.resize(n);
+  vtkSMPTools::For(0, n, [&](std::int32_t begin, std::int32_t end) {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      this->Points[i] = original[this->Ids[i]];
+    }
+  });
+}
+
+vtkIdType ParallelKdTree::FindClosestPoint(const double x[3]) const
+{
+  if (this->Ids.empty())
+  {
+    return -1;
+  }
+  const float q[3] = {static_cast<float>(x[0]), static_cast<float>(x[1]),
+                      static_cast<float>(x[2])};
+  std::int32_t closest = -1;
+  float closestDistance2 = std::numeric_limits<float>::max();
+  this->FindClosestPoint(0, 0, static_cast<std::int32_t>(this->Ids.size()), 0,
+                         q, closest, closestDistance2);
+  return this->Ids[closest];
+}
+
+void ParallelKdTree::FindClosestPoint(int node, std::int32_t begin,
+                                      std::int32_t end, int level,
+                                      const float x[3], std::int32_t& closest,
+                                      float& closestDistance2) const
+{
+  if (level == this->Depth)
+  {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      float distance2 = Distance2(this->Points[i], x);
+      if (distance2 < closestDistance2)
+      {
+        closestDistance2 = distance2;
+        closest = i;
+      }
+    }
+    return;
+  }
+
+  std::int32_t middle = begin + (end - begin) / 2;
+  float d = x[this->Axes[node]] - this->Splits[node];
+  int nearChild = d < 0.0f ? 2 * node + 1 : 2 * node + 2;
+  int farChild = d < 0.0f ? 2 * node + 2 : 2 * node + 1;
+  this->FindClosestPoint(nearChild, d < 0.0f ? begin : middle,
+                         d < 0.0f ? middle : end, level + 1, x, closest,
+                         closestDistance2);
+  if (d * d < closestDistance2)
+  {
+    this->FindClosestPoint(farChild, d < 0.0f ? middle : begin,
+                           d < 0.0f ? end : middle, level + 1, x, closest,
+                           closestDistance2);
+  }
+}
+
+// Spreads the 21 low bits of v over 63 bits, two zeros between each bit.
+std::uint64_t SpreadBits(std::uint64_t v)
+{
+  v &= 0x1FFFFF;
+  v = (v | (v << 32)) & 0x001F00000000FFFFull;
+  v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+  v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+  v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+  v = (v | (v << 2)) & 0x1249249249249249ull;
+  return v;
+}
+
+void MortonOctree::Build(vtkPoints* points, int leafSize)
+{
+  const int bits = 21;
+  auto original = ToFloat(points);
+  auto n = static_cast<std::int32_t>(original.size());
+  this->Nodes.clear();
+  this->Points.resize(n);
+  this->Ids.resize(n);
+  if (n == 0)
+  {
+    return;
+  }
+
+  // Bounding cube of the points
+  double bounds[6];
+  points->GetBounds(bounds);
+  double size = std::max({bounds[1] - bounds[0], bounds[3] - bounds[2],
+                          bounds[5] - bounds[4]});
+  size = size > 0.0 ? size * (1.0 + 1.0e-6) : 1.0;
+
+  std::vector<std::pair<std::uint64_t, std::int32_t>> codes(n);
+  double scale = (1 << bits) / size;
+  vtkSMPTools::For(0, n, [&](std::int32_t begin, std::int32_t end) {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      std::uint64_t code = 0;
+      for (int j = 0; j < 3; ++j)
+      {
+        auto cell = static_cast<std::int64_t>((original[i][j] - bounds[2 * j]) * scale);
+        cell = std::min<std::int64_t>(std::max<std::int64_t>(cell, 0), (1 << bits) - 1);
+        code |= SpreadBits(static_cast<std::uint64_t>(cell)) << j;
+      }
+      codes[i] = {code, i};
+    }
+  });
+  vtkSMPTools::Sort(codes.begin(), codes.end());
+  vtkSMPTools::For(0, n, [&](std::int32_t begin, std::int32_t end) {
+    for (std::int32_t i = begin; i < end; ++i)
+    {
+      this->Ids[i] = codes[i].second;
+      this->Points[i] = original[codes[i].second];
+    }
+  });
+
+  // Octants from the sorted codes. The sort is the expensive part, this is
+  // a binary search per child.
+  this->Nodes.push_back(Node{{static_cast<float>(bounds[0]),
+                              static_cast<float>(bounds[2]),
+                              static_cast<float>(bounds[4])},
+                             static_cast<float>(size), 0, n, -1});
+  std::vector<std::pair<std::int32_t, int>> stack = {{0, 0}};
+  while (!stack.empty())
+  {
+    auto nodeIndex = stack.back().first;
+    int level = stack.back().second;
+    stack.pop_back();
+    Node node = this->Nodes[nodeIndex];
+    if (node.End - node.Begin <= leafSize || level == bits)
+    {
+      continue;
+    }
+
+    int shift = 3 * (bits - 1 - level);
+    auto firstChild = static_cast<std::int32_t>(this->Nodes.size());
+    this->Nodes[nodeIndex].FirstChild = firstChild;
+    float half = node.Size / 2.0f;
+    std::int32_t begin = node.Begin;
+    for (std::uint64_t octant = 0; octant < 8; ++octant)
+    {
+      auto endIt = std::partition_point(
+          codes.begin() + begin, codes.begin() + node.End,
+          [&](std::pair<std::uint64_t, std::int32_t> const& c) {
+            return ((c.first >> shift) & 7) <= octant;
+          });
+      auto end = static_cast<std::int32_t>(endIt - codes.begin());
+      this->Nodes.push_back(Node{{node.Lo[0] + (octant & 1 ? half : 0.0f),
+                                  node.Lo[1] + (octant & 2 ? half : 0.0f),
+                                  node.Lo[2] + (octant & 4 ? half : 0.0f)},
+                                 half, begin, end, -1});
+      stack.push_back({firstChild + static_cast<std::int32_t>(octant), level + 1});
+      begin = end;
+    }
+  }
+}
+
+vtkIdType MortonOctree::FindClosestPoint(const double x[3]) const
+{
+  if (this->Nodes.empty())
+  {
+    return -1;
+  }
+  const float q[3] = {static_cast<float>(x[0]), static_cast<float>(x[1]),
+                      static_cast<float>(x[2])};
+  std::int32_t closest = -1;
+  float closestDistance2 = std::numeric_limits<float>::max();
+  this->FindClosestPoint(0, q, closest, closestDistance2);
+  return this->Ids[closest];
+}
+
+void MortonOctree::FindClosestPoint(std::int32_t nodeIndex, const float x[3],
+                                    std::int32_t& closest,
+                                    float& closestDistance2) const
+{
+  auto const& node = this->Nodes[nodeIndex];
+  if (node.FirstChild < 0)
+  {
+    for (std::int32_t i = node.Begin; i < node.End; ++i)
+    {
+      float distance2 = Distance2(this->Points[i], x);
+      if (distance2 < closestDistance2)
+      {
+        closestDistance2 = distance2;
+        closest = i;
+      }
+    }
+    return;
+  }
+
+  // Closest octants first
+  std::array<std::pair<float, std::int32_t>, 8> children;
+  int count = 0;
+  for (std::int32_t c = node.FirstChild; c < node.FirstChild + 8; ++c)
+  {
+    auto const& child = this->Nodes[c];
+    if (child.Begin == child.End)
+    {
+      continue;
+    }
+    float distance2 = 0.0f;
+    for (int j = 0; j < 3; ++j)
+    {
+      float d = std::max({child.Lo[j] - x[j], 0.0f, x[j] - child.Lo[j] - child.Size});
+      distance2 += d * d;
+    }
+    children[count++] = {distance2, c};
+  }
+  std::sort(children.begin(), children.begin() + count);
+  for (int i = 0; i < count; ++i)
+  {
+    if (children[i].first >= closestDistance2)
+    {
+      break;
+    }
+    this->FindClosestPoint(children[i].second, x, closest, closestDistance2);
+  }
+}
+} // namespace
@@ -0,0 +1,442 @@
+#include <vtkIdList.h>
+#include <vtkModifiedBSPTree.h>
+#include <vtkNew.h>
+#include <vtkOBBTree.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSphereSource.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+// Rays are traced in packets of PacketSize, stored as structure of arrays so
+// that every per-ray loop below compiles to SIMD instructions (build with
+// -DSIMD=SIMD128 for WebAssembly).
+constexpr int PacketSize = 8;
+
+struct RayPacket
+{
+  // Segments p1 + t * (p2 - p1), t in [0, 1], like IntersectWithLine
+  alignas(32) float Origin[3][PacketSize];
+  alignas(32) float Direction[3][PacketSize];
+  alignas(32) float InverseDirection[3][PacketSize];
+  alignas(32) float T[PacketSize];
+  alignas(32) std::int32_t CellId[PacketSize];
+};
+
+// Bounding volume hierarchy over the triangles, stored as a flat array: the
+// children of an inner node are Nodes[First] and Nodes[First + 1], a leaf
+// holds Triangles[First] ... Triangles[First + Count - 1].
+struct Node
+{
+  float Min[3];
+  float Max[3];
+  std::int32_t First;
+  std::int32_t Count;
+};
+
+struct Triangle
+{
+  float V0[3];
+  float Edge1[3];
+  float Edge2[3];
+  std::int32_t CellId;
+};
+
+struct PacketTree
+{
+  std::vector<Node> Nodes;
+  std::vector<Triangle> Triangles;
+
+  void Build(vtkPolyData* polydata);
+  void Intersect(RayPacket& packet) const;
+
+private:
+  void Split(std::int32_t nodeIndex, std::vector<float>& centroids);
+  std::uint32_t IntersectBox(const Node& node, const RayPacket& packet) const;
+  void IntersectTriangle(const Triangle& triangle, RayPacket& packet) const;
+};
+
+void MakeRays(vtkPolyData* polydata, int resolution,
+              std::vector<std::array<double, 6>>& rays);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: RayPacketIntersection [sphere resolution] [ray grid resolution]
+  int sphereResolution = 500;
+  int rayResolution = 512;
+  if (argc > 1)
+  {
+    sphereResolution = std::atoi(argv[1]);
+  }
+  if (argc > 2)
+  {
+    rayResolution = std::atoi(argv[2]);
+  }
+
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(sphereResolution);
+  sphere->SetPhiResolution(sphereResolution);
+  sphere->Update();
+  auto polydata = sphere->GetOutput();
+
+  // Rays from a camera-like grid: neighbouring rays hit neighbouring cells.
+  std::vector<std::array<double, 6>> rays;
+  MakeRays(polydata, rayResolution, rays);
+  auto numberOfRays = static_cast<vtkIdType>(rays.size());
+  std::cout << polydata->GetNumberOfCells() << " triangles, " << numberOfRays
+            << " rays" << std::endl;
+
+  vtkNew<vtkTimerLog> timer;
+  double t;
+  double x[3];
+  double pcoords[3];
+  int subId;
+  vtkIdType cellId;
+
+  // One ray at a time through the VTK trees
+  vtkNew<vtkOBBTree> obbTree;
+  obbTree->SetDataSet(polydata);
+  obbTree->BuildLocator();
+  std::vector<float> obbT(numberOfRays);
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    obbT[i] = obbTree->IntersectWithLine(rays[i].data(), rays[i].data() + 3,
+                                         0.0, t, x, pcoords, subId, cellId)
+        ? static_cast<float>(t)
+        : 2.0f;
+  }
+  timer->StopTimer();
+  double obbTime = timer->GetElapsedTime();
+
+  vtkNew<vtkModifiedBSPTree> bspTree;
+  bspTree->SetDataSet(polydata);
+  bspTree->BuildLocator();
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    bspTree->IntersectWithLine(rays[i].data(), rays[i].data() + 3, 0.0, t, x,
+                               pcoords, subId, cellId);
+  }
+  timer->StopTimer();
+  double bspTime = timer->GetElapsedTime();
+
+  // Packets
+  timer->StartTimer();
+  PacketTree packetTree;
+  packetTree.Build(polydata);
+  timer->StopTimer();
+  double packetBuildTime = timer->GetElapsedTime();
+
+  std::vector<float> packetT(numberOfRays);
+  timer->StartTimer();
+  for (vtkIdType first = 0; first < numberOfRays; first += PacketSize)
+  {
+    RayPacket packet;
+    for (int lane = 0; lane < PacketSize; ++lane)
+    {
+      // Pad the last packet with copies of its last ray
+      auto const& ray = rays[std::min(first + lane, numberOfRays - 1)];
+      for (int j = 0; j < 3; ++j)
+      {
+        packet.Origin[j][lane] = static_cast<float>(ray[j]);
+        packet.Direction[j][lane] = static_cast<float>(ray[j + 3] - ray[j]);
+        packet.InverseDirection[j][lane] = 1.0f / packet.Direction[j][lane];
+      }
+      packet.T[lane] = 1.0f;
+      packet.CellId[lane] = -1;
+    }
+    packetTree.Intersect(packet);
+    for (int lane = 0; lane < PacketSize && first + lane < numberOfRays; ++lane)
+    {
+      packetT[first + lane] = packet.CellId[lane] < 0 ? 2.0f : packet.T[lane];
+    }
+  }
+  timer->StopTimer();
+  double packetTime = timer->GetElapsedTime();
+
+  vtkIdType hits = 0;
+  vtkIdType mismatches = 0;
+  for (vtkIdType i = 0; i < numberOfRays; ++i)
+  {
+    hits += obbT[i] <= 1.0f;
+    // Rays grazing an edge may be resolved differently
+    mismatches += std::abs(obbT[i] - packetT[i]) > 1.0e-4f;
+  }
+
+  std::cout << "vtkOBBTree:         " << obbTime << " s" << std::endl;
+  std::cout << "vtkModifiedBSPTree: " << bspTime << " s" << std::endl;
+  std::cout << "Ray packets:        " << packetTime << " s, "
+            << obbTime / packetTime << "x vtkOBBTree, built in "
+            << packetBuildTime << " s" << std::endl;
+  std::cout << hits << " hits, " << mismatches
+            << " rays differ from vtkOBBTree" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+void PacketTree::Build(vtkPolyData* polydata)
+{
+  vtkIdType numberOfCells = polydata->GetNumberOfCells();
+  this->Triangles.clear();
+  this->Triangles.reserve(numberOfCells);
+  std::vector<float> centroids;
+  centroids.reserve(3 * numberOfCells);
+
+  vtkNew<vtkIdList> pointIds;
+  for (vtkIdType cellId = 0; cellId < numberOfCells; ++cellId)
+  {
+    polydata->GetCellPoints(cellId, pointIds);
+    if (pointIds->GetNumberOfIds() != 3)
+    {
+      continue;
+    }
+    double p[3][3];
+    for (int i = 0; i < 3; ++i)
+    {
+      polydata->GetPoint(pointIds->GetId(i), p[i]);
+    }
+    Triangle triangle;
+    for (int j = 0; j < 3; ++j)
+    {
+      triangle.V0[j] = static_cast<float>(p[0][j]);
+      triangle.Edge1[j] = static_cast<float>(p[1][j] - p[0][j]);
+      triangle.Edge2[j] = static_cast<float>(p[2][j] - p[0][j]);
+      centroids.push_back(static_cast<float>((p[0][j] + p[1][j] + p[2][j]) / 3.0));
+    }
+    triangle.CellId = static_cast<std::int32_t>(cellId);
+    this->Triangles.push_back(triangle);
+  }
+
+  this->Nodes.clear();
+  this->Nodes.reserve(2 * this->Triangles.size());
+  this->Nodes.push_back(
+      Node{{0, 0, 0}, {0, 0, 0}, 0, static_cast<std::int32_t>(this->Triangles.size())});
+  this->Split(0, centroids);
+}
+
+// Median split along the longest axis of the centroids, down to 4 triangles.
+void PacketTree::Split(std::int32_t nodeIndex, std::vector<float>& centroids)
+{
+  std::int32_t first = this->Nodes[nodeIndex].First;
+  std::int32_t count = this->Nodes[nodeIndex].Count;
+
+  float boxMin[3];
+  float boxMax[3];
+  float centerMin[3];
+  float centerMax[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    boxMin[j] = centerMin[j] = std::numeric_limits<float>::max();
+    boxMax[j] = centerMax[j] = std::numeric_limits<float>::lowest();
+  }
+  for (std::int32_t i = first; i < first + count; ++i)
+  {
+    auto const& triangle = this->Triangles[i];
+    for (int j = 0; j < 3; ++j)
+    {
+      float v0 = triangle.V0[j];
+      float v1 = v0 + triangle.Edge1[j];
+      float v2 = v0 + triangle.Edge2[j];
+      boxMin[j] = std::min({boxMin[j], v0, v1, v2});
+      boxMax[j] = std::max({boxMax[j], v0, v1, v2});
+      centerMin[j] = std::min(centerMin[j], centroids[3 * i + j]);
+      centerMax[j] = std::max(centerMax[j], centroids[3 * i + j]);
+    }
+  }
+  std::copy(boxMin, boxMin + 3, this->Nodes[nodeIndex].Min);
+  std::copy(boxMax, boxMax + 3, this->Nodes[nodeIndex].Max);
+
+  if (count <= 4)
+  {
+    return;
+  }
+
+  int axis = 0;
+  for (int j = 1; j < 3; ++j)
+  {
+    if (centerMax[j] - centerMin[j] > centerMax[axis] - centerMin[axis])
+    {
+      axis = j;
+    }
+  }
+
+  // Sort triangles and their centroids together through an index
+  std::vector<std::int32_t> order(count);
+  for (std::int32_t i = 0; i < count; ++i)
+  {
+    order[i] = first + i;
+  }
+  std::int32_t half = count / 2;
+  std::nth_element(order.begin(), order.begin() + half, order.end(),
+                   [&](std::int32_t a, std::int32_t b) {
+                     return centroids[3 * a + axis] < centroids[3 * b + axis];
+                   });
+  std::vector<Triangle> triangles(count);
+  std::vector<float> centers(3 * count);
+  for (std::int32_t i = 0; i < count; ++i)
+  {
+    triangles[i] = this->Triangles[order[i]];
+    std::copy(&centroids[3 * order[i]], &centroids[3 * order[i]] + 3, &centers[3 * i]);
+  }
+  std::copy(triangles.begin(), triangles.end(), this->Triangles.begin() + first);
+  std::copy(centers.begin(), centers.end(), centroids.begin() + 3 * first);
+
+  auto left = static_cast<std::int32_t>(this->Nodes.size());
+  this->Nodes[nodeIndex].First = left;
+  this->Nodes[nodeIndex].Count = 0;
+  this->Nodes.push_back(Node{{0, 0, 0}, {0, 0, 0}, first, half});
+  this->Nodes.push_back(Node{{0, 0, 0}, {0, 0, 0}, first + half, count - half});
+  this->Split(left, centroids);
+  this->Split(left + 1, centroids);
+}
+
+// Slab test of the box against every ray, returns the mask of the rays that
+// enter the box before their current hit.
+std::uint32_t PacketTree::IntersectBox(const Node& node,
+                                       const RayPacket& packet) const
+{
+  alignas(32) float enter[PacketSize];
+  alignas(32) float exit[PacketSize];
+  for (int lane = 0; lane < PacketSize; ++lane)
+  {
+    enter[lane] = 0.0f;
+    exit[lane] = packet.T[lane];
+  }
+  for (int j = 0; j < 3; ++j)
+  {
+    for (int lane = 0; lane < PacketSize; ++lane)
+    {
+      float t0 = (node.Min[j] - packet.Origin[j][lane]) * packet.InverseDirection[j][lane];
+      float t1 = (node.Max[j] - packet.Origin[j][lane]) * packet.InverseDirection[j][lane];
+      enter[lane] = std::max(enter[lane], std::min(t0, t1));
+      exit[lane] = std::min(exit[lane], std::max(t0, t1));
+    }
+  }
+  std::uint32_t mask = 0;
+  for (int lane = 0; lane < PacketSize; ++lane)
+  {
+    mask |= static_cast<std::uint32_t>(enter[lane] <= exit[lane]) << lane;
+  }
+  return mask;
+}
+
+// Moller-Trumbore on every ray, keeps the closest hit of each ray.
+void PacketTree::IntersectTriangle(const Triangle& triangle,
+                                   RayPacket& packet) const
+{
+  const float* e1 = triangle.Edge1;
+  const float* e2 = triangle.Edge2;
+  for (int lane = 0; lane < PacketSize; ++lane)
+  {
+    float dx = packet.Direction[0][lane];
+    float dy = packet.Direction[1][lane];
+    float dz = packet.Direction[2][lane];
+    // p = d x e2
+    float px = dy * e2[2] - dz * e2[1];
+    float py = dz * e2[0] - dx * e2[2];
+    float pz = dx * e2[1] - dy * e2[0];
+    float det = e1[0] * px + e1[1] * py + e1[2] * pz;
+    float inverseDet = 1.0f / det;
+    float sx = packet.Origin[0][lane] - triangle.V0[0];
+    float sy = packet.Origin[1][lane] - triangle.V0[1];
+    float sz = packet.Origin[2][lane] - triangle.V0[2];
+    float u = (sx * px + sy * py + sz * pz) * inverseDet;
+    // q = s x e1
+    float qx = sy * e1[2] - sz * e1[1];
+    float qy = sz * e1[0] - sx * e1[2];
+    float qz = sx * e1[1] - sy * e1[0];
+    float v = (dx * qx + dy * qy + dz * qz) * inverseDet;
+    float t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * inverseDet;
+    bool hit = det != 0.0f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f &&
+        t >= 0.0f && t < packet.T[lane];
+    packet.T[lane] = hit ? t : packet.T[lane];
+    packet.CellId[lane] = hit ? triangle.CellId : packet.CellId[lane];
+  }
+}
+
+void PacketTree::Intersect(RayPacket& packet) const
+{
+  // Visit the near child first, as seen along the first ray
+  std::int32_t stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0)
+  {
+    const Node& node = this->Nodes[stack[--top]];
+    if (!this->IntersectBox(node, packet))
+    {
+      continue;
+    }
+    if (node.Count > 0)
+    {
+      for (std::int32_t i = node.First; i < node.First + node.Count; ++i)
+      {
+        this->IntersectTriangle(this->Triangles[i], packet);
+      }
+      continue;
+    }
+    const Node& left = this->Nodes[node.First];
+    int axis = 0;
+    float extent = 0.0f;
+    for (int j = 0; j < 3; ++j)
+    {
+      float e = std::abs((left.Min[j] + left.Max[j]) -
+                         (this->Nodes[node.First + 1].Min[j] +
+                          this->Nodes[node.First + 1].Max[j]));
+      if (e > extent)
+      {
+        extent = e;
+        axis = j;
+      }
+    }
+    bool leftIsNear = (left.Min[axis] + left.Max[axis] <
+                       this->Nodes[node.First + 1].Min[axis] +
+                           this->Nodes[node.First + 1].Max[axis]) ==
+        (packet.Direction[axis][0] > 0.0f);
+    stack[top++] = leftIsNear ? node.First + 1 : node.First;
+    stack[top++] = leftIsNear ? node.First : node.First + 1;
+  }
+}
+
+void MakeRays(vtkPolyData* polydata, int resolution,
+              std::vector<std::array<double, 6>>& rays)
+{
+  double bounds[6];
+  polydata->GetBounds(bounds);
+  double center[3];
+  double size = 0.0;
+  for (int j = 0; j < 3; ++j)
+  {
+    center[j] = 0.5 * (bounds[2 * j] + bounds[2 * j + 1]);
+    size = std::max(size, bounds[2 * j + 1] - bounds[2 * j]);
+  }
+
+  // An eye in front of the mesh looking at a grid behind it. Packets are taken
+  // from consecutive rays of a row.
+  rays.clear();
+  rays.reserve(static_cast<size_t>(resolution) * resolution);
+  for (int row = 0; row < resolution; ++row)
+  {
+    for (int column = 0; column < resolution; ++column)
+    {
+      double u = (column + 0.5) / resolution - 0.5;
+      double v = (row + 0.5) / resolution - 0.5;
+      rays.push_back({center[0], center[1], center[2] + 2.0 * size,
+                      center[0] + 2.4 * size * u, center[1] + 2.4 * size * v,
+                      center[2] - 2.0 * size});
+    }
+  }
+}
+} // namespace
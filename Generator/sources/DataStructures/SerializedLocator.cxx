@@ -0,0 +1,794 @@
+#include <vtkCellArray.h>
+#include <vtkCellLocator.h>
+#include <vtkGenericCell.h>
+#include <vtkMath.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLPolyDataReader.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Layout of a locator blob: this header, then sections of 64 bit integers.
+// Nothing is parsed or copied when the blob is loaded, the sections are used
+// in place.
+struct BlobHeader
+{
+  char Magic[8];
+  // 0x01020304 as written, the blob is not portable across byte orders
+  std::uint32_t ByteOrder;
+  std::uint32_t Version;
+  // Fingerprint of the points and cells the locator was built for
+  std::uint64_t DataSetHash;
+  std::int64_t NumberOfPoints;
+  std::int64_t NumberOfCells;
+  double Bounds[6];
+  // The 4th division pads the header to 8 bytes
+  std::int32_t Divisions[4];
+  // Sections, in bytes from the start of the blob:
+  // the points of bucket b are PointIds[PointOffsets[b]] ...
+  // PointIds[PointOffsets[b + 1] - 1], the same for the cells.
+  std::int64_t PointOffsets;
+  std::int64_t PointIds;
+  std::int64_t CellOffsets;
+  std::int64_t CellIds;
+  std::int64_t Size;
+};
+
+const char BlobMagic[8] = {'V', 'T', 'K', 'L', 'O', 'C', 'B', '\0'};
+const std::uint32_t BlobVersion = 2;
+
+// Hash of the point coordinates and cell arrays. Unlike the MTime, it stays
+// the same across sessions, so a blob can be shipped with its dataset.
+std::uint64_t HashDataSet(vtkPolyData* polydata);
+
+// Bucket grid over the points and the cells of a vtkPolyData, the structure
+// vtkStaticPointLocator and vtkCellLocator build, flattened to a blob.
+// A cell is in every bucket its bounding box overlaps.
+class FlatLocator
+{
+public:
+  static std::vector<std::int64_t> Build(vtkPolyData* polydata,
+                                         int numberOfPointsPerBucket);
+
+  // Uses the blob in place, it must outlive the locator. Fails if the blob
+  // is damaged or was built for another dataset.
+  bool Attach(const void* blob, std::size_t size, vtkPolyData* polydata);
+
+  vtkIdType FindClosestPoint(const double x[3]) const;
+
+  // Closest point of the cells, as vtkCellLocator::FindClosestPoint
+  void FindClosestPoint(const double x[3], double closestPoint[3],
+                        vtkIdType& cellId, double& dist2) const;
+
+private:
+  void GetBucket(const double x[3], int ijk[3]) const;
+
+  // Calls visit(bucket) for the buckets of the shell at level around ijk
+  template <typename Visit>
+  void VisitShell(const int ijk[3], int level, Visit visit) const;
+
+  vtkPolyData* DataSet = nullptr;
+  const BlobHeader* Header = nullptr;
+  const std::int64_t* PointOffsets = nullptr;
+  const std::int64_t* PointIds = nullptr;
+  const std::int64_t* CellOffsets = nullptr;
+  const std::int64_t* CellIds = nullptr;
+  double H[3];
+  // Cells are in several buckets, the stamp avoids evaluating them twice
+  mutable std::vector<std::uint32_t> Visited;
+  mutable std::uint32_t Stamp = 0;
+  mutable std::vector<double> Weights;
+  vtkNew<vtkGenericCell> Cell;
+};
+
+// Read only view of a whole file, mapped where the platform allows it.
+class MappedFile
+{
+public:
+  ~MappedFile();
+  bool Open(std::string const& fileName);
+  const void* GetData() const
+  {
+    return this->Data;
+  }
+  std::size_t GetSize() const
+  {
+    return this->Size;
+  }
+
+private:
+  const void* Data = nullptr;
+  std::size_t Size = 0;
+#ifdef _WIN32
+  std::vector<std::int64_t> Buffer;
+#endif
+};
+
+bool WriteBlob(std::string const& fileName,
+               std::vector<std::int64_t> const& blob);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " file.vtp [locator blob]"
+              << std::endl;
+    std::cout << "e.g. Bunny.vtp" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string blobName = argc > 2 ? argv[2] : std::string(argv[1]) + ".locator";
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkXMLPolyDataReader> reader;
+  reader->SetFileName(argv[1]);
+  reader->Update();
+  auto polydata = reader->GetOutput();
+  std::cout << argv[1] << ": " << polydata->GetNumberOfPoints() << " points, "
+            << polydata->GetNumberOfCells() << " cells" << std::endl;
+
+  // What every example does at startup
+  timer->StartTimer();
+  vtkNew<vtkStaticPointLocator> pointLocator;
+  pointLocator->SetDataSet(polydata);
+  pointLocator->BuildLocator();
+  vtkNew<vtkCellLocator> cellLocator;
+  cellLocator->SetDataSet(polydata);
+  cellLocator->BuildLocator();
+  timer->StopTimer();
+  double buildTime = timer->GetElapsedTime();
+  std::cout << "BuildLocator (vtkStaticPointLocator + vtkCellLocator): "
+            << buildTime << " s" << std::endl;
+
+  // Load the blob, (re)build it if it is missing or stale
+  FlatLocator locator;
+  MappedFile file;
+  timer->StartTimer();
+  bool loaded = file.Open(blobName) &&
+      locator.Attach(file.GetData(), file.GetSize(), polydata);
+  timer->StopTimer();
+  if (loaded)
+  {
+    std::cout << "Loaded " << blobName << " (" << file.GetSize()
+              << " bytes): " << timer->GetElapsedTime() << " s, "
+              << buildTime / timer->GetElapsedTime() << "x faster"
+              << std::endl;
+  }
+  else
+  {
+    std::cout << blobName << " is missing or stale, building it" << std::endl;
+    timer->StartTimer();
+    auto blob = FlatLocator::Build(polydata, 2);
+    timer->StopTimer();
+    std::cout << "Built the blob (" << blob.size() * sizeof(std::int64_t)
+              << " bytes): " << timer->GetElapsedTime() << " s" << std::endl;
+    if (!WriteBlob(blobName, blob) || !file.Open(blobName) ||
+        !locator.Attach(file.GetData(), file.GetSize(), polydata))
+    {
+      std::cout << "Could not write " << blobName << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << blobName
+              << ", run again to load it instead of building" << std::endl;
+  }
+
+  // The blob answers like the VTK locators
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  double bounds[6];
+  polydata->GetBounds(bounds);
+  int pointMismatches = 0;
+  int cellMismatches = 0;
+  const int numberOfQueries = 1000;
+  for (int i = 0; i < numberOfQueries; ++i)
+  {
+    double x[3];
+    for (int j = 0; j < 3; ++j)
+    {
+      // Queries reach a little outside of the bounds
+      double length = bounds[2 * j + 1] - bounds[2 * j];
+      x[j] = rng->GetRangeValue(bounds[2 * j] - 0.1 * length,
+                                bounds[2 * j + 1] + 0.1 * length);
+      rng->Next();
+    }
+    vtkIdType id = locator.FindClosestPoint(x);
+    vtkIdType expected = pointLocator->FindClosestPoint(x);
+    if (id != expected &&
+        vtkMath::Distance2BetweenPoints(x, polydata->GetPoint(id)) !=
+            vtkMath::Distance2BetweenPoints(x, polydata->GetPoint(expected)))
+    {
+      ++pointMismatches;
+    }
+
+    double closest[3];
+    vtkIdType cellId;
+    int subId;
+    double dist2;
+    double expectedDist2;
+    locator.FindClosestPoint(x, closest, cellId, dist2);
+    cellLocator->FindClosestPoint(x, closest, cellId, subId, expectedDist2);
+    if (std::abs(dist2 - expectedDist2) > 1.0e-9 * (1.0 + expectedDist2))
+    {
+      ++cellMismatches;
+    }
+  }
+  std::cout << numberOfQueries << " queries: " << pointMismatches
+            << " closest point mismatches, " << cellMismatches
+            << " closest cell mismatches" << std::endl;
+
+  return pointMismatches == 0 && cellMismatches == 0 ? EXIT_SUCCESS
+                                                     : EXIT_FAILURE;
+}
+
+namespace {
+// FNV-1a, a 64 bit word at a time
+struct Hasher
+{
+  std::uint64_t Value = 14695981039346656037ull;
+
+  void Add(std::uint64_t word)
+  {
+    this->Value = (this->Value ^ word) * 1099511628211ull;
+  }
+
+  // The last word is padded with zeros
+  void AddBytes(const void* data, std::size_t size)
+  {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i += sizeof(std::uint64_t))
+    {
+      std::uint64_t word = 0;
+      std::memcpy(&word, bytes + i, std::min(sizeof(word), size - i));
+      this->Add(word);
+    }
+  }
+
+  // Ids are hashed as 64 bit integers, so the hash does not depend on the
+  // storage of the cell arrays (32 bit on wasm32 builds of VTK)
+  void AddIds(const vtkTypeInt64* ids, vtkIdType count)
+  {
+    this->AddBytes(ids, count * sizeof(vtkTypeInt64));
+  }
+
+  void AddIds(const vtkTypeInt32* ids, vtkIdType count)
+  {
+    for (vtkIdType i = 0; i < count; ++i)
+    {
+      this->Add(static_cast<std::uint64_t>(static_cast<std::int64_t>(ids[i])));
+    }
+  }
+
+  void Add(vtkCellArray* cells)
+  {
+    vtkIdType numberOfCells = cells->GetNumberOfCells();
+    this->Add(static_cast<std::uint64_t>(numberOfCells));
+    if (numberOfCells == 0)
+    {
+      return;
+    }
+    vtkIdType numberOfIds = cells->GetNumberOfConnectivityIds();
+    if (cells->IsStorage64Bit())
+    {
+      this->AddIds(cells->GetOffsetsArray64()->GetPointer(0), numberOfCells + 1);
+      this->AddIds(cells->GetConnectivityArray64()->GetPointer(0), numberOfIds);
+    }
+    else
+    {
+      this->AddIds(cells->GetOffsetsArray32()->GetPointer(0), numberOfCells + 1);
+      this->AddIds(cells->GetConnectivityArray32()->GetPointer(0), numberOfIds);
+    }
+  }
+};
+
+std::uint64_t HashDataSet(vtkPolyData* polydata)
+{
+  // The raw buffers, no virtual call per point or cell
+  Hasher hasher;
+  hasher.Add(static_cast<std::uint64_t>(polydata->GetNumberOfPoints()));
+  if (auto points = polydata->GetPoints())
+  {
+    auto data = points->GetData();
+    hasher.Add(static_cast<std::uint64_t>(data->GetDataType()));
+    hasher.AddBytes(data->GetVoidPointer(0),
+                    static_cast<std::size_t>(data->GetNumberOfValues()) *
+                        data->GetDataTypeSize());
+  }
+  hasher.Add(polydata->GetVerts());
+  hasher.Add(polydata->GetLines());
+  hasher.Add(polydata->GetPolys());
+  hasher.Add(polydata->GetStrips());
+  return hasher.Value;
+}
+
+// Bucket of x in a grid, x outside of the grid goes to the closest bucket
+void BucketOf(const double x[3], const double bounds[6],
+              const std::int32_t divisions[3], const double h[3], int ijk[3])
+{
+  for (int j = 0; j < 3; ++j)
+  {
+    auto i = static_cast<int>(std::floor((x[j] - bounds[2 * j]) / h[j]));
+    ijk[j] = std::min(std::max(i, 0), divisions[j] - 1);
+  }
+}
+
+std::vector<std::int64_t> FlatLocator::Build(vtkPolyData* polydata,
+                                             int numberOfPointsPerBucket)
+{
+  vtkIdType numberOfPoints = polydata->GetNumberOfPoints();
+  vtkIdType numberOfCells = polydata->GetNumberOfCells();
+
+  BlobHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.Magic, BlobMagic, sizeof(BlobMagic));
+  header.ByteOrder = 0x01020304;
+  header.Version = BlobVersion;
+  header.DataSetHash = HashDataSet(polydata);
+  header.NumberOfPoints = numberOfPoints;
+  header.NumberOfCells = numberOfCells;
+  polydata->GetBounds(header.Bounds);
+
+  // About numberOfPointsPerBucket points per bucket, flat axes get one
+  double length[3];
+  double volume = 1.0;
+  int dimension = 0;
+  double maxLength = 0.0;
+  for (int j = 0; j < 3; ++j)
+  {
+    length[j] = header.Bounds[2 * j + 1] - header.Bounds[2 * j];
+    maxLength = std::max(maxLength, length[j]);
+  }
+  for (int j = 0; j < 3; ++j)
+  {
+    if (length[j] > 1.0e-6 * maxLength)
+    {
+      volume *= length[j];
+      ++dimension;
+    }
+  }
+  double numberOfBuckets =
+      std::max(1.0, static_cast<double>(numberOfPoints) / numberOfPointsPerBucket);
+  double h = dimension ? std::pow(volume / numberOfBuckets, 1.0 / dimension) : 1.0;
+  double spacing[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    header.Divisions[j] = length[j] > 1.0e-6 * maxLength
+        ? static_cast<std::int32_t>(std::min(1024.0, std::max(1.0, length[j] / h)))
+        : 1;
+    if (length[j] <= 0.0)
+    {
+      // Keep the bucket size finite for flat datasets
+      header.Bounds[2 * j + 1] = header.Bounds[2 * j] + (maxLength > 0.0 ? maxLength : 1.0);
+      length[j] = header.Bounds[2 * j + 1] - header.Bounds[2 * j];
+    }
+    spacing[j] = length[j] / header.Divisions[j];
+  }
+  vtkIdType bucketCount = static_cast<vtkIdType>(header.Divisions[0]) *
+      header.Divisions[1] * header.Divisions[2];
+  auto bucketIndex = [&](int i, int j, int k) {
+    return i + header.Divisions[0] * (j + static_cast<vtkIdType>(header.Divisions[1]) * k);
+  };
+
+  // Points: counting sort by bucket
+  std::vector<std::int64_t> pointOffsets(bucketCount + 1, 0);
+  std::vector<std::int64_t> pointBuckets(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    int ijk[3];
+    BucketOf(polydata->GetPoint(i), header.Bounds, header.Divisions, spacing, ijk);
+    pointBuckets[i] = bucketIndex(ijk[0], ijk[1], ijk[2]);
+    ++pointOffsets[pointBuckets[i] + 1];
+  }
+  for (vtkIdType b = 0; b < bucketCount; ++b)
+  {
+    pointOffsets[b + 1] += pointOffsets[b];
+  }
+  std::vector<std::int64_t> pointIds(numberOfPoints);
+  {
+    std::vector<std::int64_t> next(pointOffsets.begin(), pointOffsets.end() - 1);
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+      pointIds[next[pointBuckets[i]]++] = i;
+    }
+  }
+
+  // Cells: every bucket their bounds overlap, counted then filled
+  std::vector<std::int64_t> cellOffsets(bucketCount + 1, 0);
+  std::vector<std::array<int, 6>> cellRanges(numberOfCells);
+  for (vtkIdType c = 0; c < numberOfCells; ++c)
+  {
+    double cellBounds[6];
+    polydata->GetCellBounds(c, cellBounds);
+    double lo[3] = {cellBounds[0], cellBounds[2], cellBounds[4]};
+    double hi[3] = {cellBounds[1], cellBounds[3], cellBounds[5]};
+    int ijkLo[3];
+    int ijkHi[3];
+    BucketOf(lo, header.Bounds, header.Divisions, spacing, ijkLo);
+    BucketOf(hi, header.Bounds, header.Divisions, spacing, ijkHi);
+    cellRanges[c] = {ijkLo[0], ijkHi[0], ijkLo[1], ijkHi[1], ijkLo[2], ijkHi[2]};
+    for (int k = ijkLo[2]; k <= ijkHi[2]; ++k)
+    {
+      for (int j = ijkLo[1]; j <= ijkHi[1]; ++j)
+      {
+        for (int i = ijkLo[0]; i <= ijkHi[0]; ++i)
+        {
+          ++cellOffsets[bucketIndex(i, j, k) + 1];
+        }
+      }
+    }
+  }
+  for (vtkIdType b = 0; b < bucketCount; ++b)
+  {
+    cellOffsets[b + 1] += cellOffsets[b];
+  }
+  std::vector<std::int64_t> cellIds(cellOffsets[bucketCount]);
+  {
+    std::vector<std::int64_t> next(cellOffsets.begin(), cellOffsets.end() - 1);
+    for (vtkIdType c = 0; c < numberOfCells; ++c)
+    {
+      auto const& r = cellRanges[c];
+      for (int k = r[4]; k <= r[5]; ++k)
+      {
+        for (int j = r[2]; j <= r[3]; ++j)
+        {
+          for (int i = r[0]; i <= r[1]; ++i)
+          {
+            cellIds[next[bucketIndex(i, j, k)]++] = c;
+          }
+        }
+      }
+    }
+  }
+
+  // Header, then the sections
+  const auto word = static_cast<std::int64_t>(sizeof(std::int64_t));
+  header.PointOffsets = sizeof(BlobHeader);
+  header.PointIds = header.PointOffsets + word * static_cast<std::int64_t>(pointOffsets.size());
+  header.CellOffsets = header.PointIds + word * static_cast<std::int64_t>(pointIds.size());
+  header.CellIds = header.CellOffsets + word * static_cast<std::int64_t>(cellOffsets.size());
+  header.Size = header.CellIds + word * static_cast<std::int64_t>(cellIds.size());
+
+  std::vector<std::int64_t> blob(header.Size / word);
+  std::memcpy(blob.data(), &header, sizeof(header));
+  auto copy = [&](std::vector<std::int64_t> const& section, std::int64_t offset) {
+    std::copy(section.begin(), section.end(), blob.begin() + offset / word);
+  };
+  copy(pointOffsets, header.PointOffsets);
+  copy(pointIds, header.PointIds);
+  copy(cellOffsets, header.CellOffsets);
+  copy(cellIds, header.CellIds);
+  return blob;
+}
+
+bool FlatLocator::Attach(const void* blob, std::size_t size, vtkPolyData* polydata)
+{
+  this->Header = nullptr;
+  if (!blob || size < sizeof(BlobHeader) ||
+      reinterpret_cast<std::uintptr_t>(blob) % sizeof(std::int64_t) != 0)
+  {
+    return false;
+  }
+  auto header = static_cast<const BlobHeader*>(blob);
+  if (std::memcmp(header->Magic, BlobMagic, sizeof(BlobMagic)) != 0 ||
+      header->ByteOrder != 0x01020304 || header->Version != BlobVersion ||
+      header->Size != static_cast<std::int64_t>(size) ||
+      header->NumberOfPoints != polydata->GetNumberOfPoints() ||
+      header->NumberOfCells != polydata->GetNumberOfCells())
+  {
+    return false;
+  }
+
+  // The grid
+  double h[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    if (header->Divisions[j] < 1 || header->Divisions[j] > 1024)
+    {
+      return false;
+    }
+    h[j] = (header->Bounds[2 * j + 1] - header->Bounds[2 * j]) /
+        header->Divisions[j];
+    if (!std::isfinite(header->Bounds[2 * j]) || !std::isfinite(h[j]) ||
+        h[j] <= 0.0)
+    {
+      return false;
+    }
+  }
+
+  // The sections follow the header in order, are aligned and fill the blob
+  const auto word = static_cast<std::int64_t>(sizeof(std::int64_t));
+  std::int64_t buckets = static_cast<std::int64_t>(header->Divisions[0]) *
+      header->Divisions[1] * header->Divisions[2];
+  const std::int64_t sections[5] = {header->PointOffsets, header->PointIds,
+                                    header->CellOffsets, header->CellIds,
+                                    header->Size};
+  if (header->PointOffsets != static_cast<std::int64_t>(sizeof(BlobHeader)))
+  {
+    return false;
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    if (sections[i] % word != 0 || sections[i + 1] < sections[i] ||
+        sections[i + 1] > header->Size)
+    {
+      return false;
+    }
+  }
+  if (header->PointIds - header->PointOffsets != word * (buckets + 1) ||
+      header->CellOffsets - header->PointIds != word * header->NumberOfPoints ||
+      header->CellIds - header->CellOffsets != word * (buckets + 1))
+  {
+    return false;
+  }
+
+  // The offsets start at 0, never decrease and end at the number of ids, the
+  // ids are in range
+  auto base = static_cast<const char*>(blob);
+  auto pointOffsets = reinterpret_cast<const std::int64_t*>(base + header->PointOffsets);
+  auto pointIds = reinterpret_cast<const std::int64_t*>(base + header->PointIds);
+  auto cellOffsets = reinterpret_cast<const std::int64_t*>(base + header->CellOffsets);
+  auto cellIds = reinterpret_cast<const std::int64_t*>(base + header->CellIds);
+  auto validOffsets = [&](const std::int64_t* offsets, std::int64_t count) {
+    if (offsets[0] != 0 || offsets[buckets] != count)
+    {
+      return false;
+    }
+    for (std::int64_t b = 0; b < buckets; ++b)
+    {
+      if (offsets[b + 1] < offsets[b])
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto validIds = [](const std::int64_t* ids, std::int64_t count, std::int64_t end) {
+    for (std::int64_t i = 0; i < count; ++i)
+    {
+      if (ids[i] < 0 || ids[i] >= end)
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+  std::int64_t numberOfCellIds = (header->Size - header->CellIds) / word;
+  if (!validOffsets(pointOffsets, header->NumberOfPoints) ||
+      !validOffsets(cellOffsets, numberOfCellIds) ||
+      !validIds(pointIds, header->NumberOfPoints, header->NumberOfPoints) ||
+      !validIds(cellIds, numberOfCellIds, header->NumberOfCells))
+  {
+    return false;
+  }
+
+  // Last, as it is the slowest check
+  if (header->DataSetHash != HashDataSet(polydata))
+  {
+    return false;
+  }
+
+  this->DataSet = polydata;
+  this->Header = header;
+  this->PointOffsets = pointOffsets;
+  this->PointIds = pointIds;
+  this->CellOffsets = cellOffsets;
+  this->CellIds = cellIds;
+  std::copy(h, h + 3, this->H);
+  this->Visited.assign(header->NumberOfCells, 0);
+  this->Stamp = 0;
+  this->Weights.resize(std::max(1, polydata->GetMaxCellSize()));
+  return true;
+}
+
+void FlatLocator::GetBucket(const double x[3], int ijk[3]) const
+{
+  BucketOf(x, this->Header->Bounds, this->Header->Divisions, this->H, ijk);
+}
+
+template <typename Visit>
+void FlatLocator::VisitShell(const int ijk[3], int level, Visit visit) const
+{
+  auto const* divisions = this->Header->Divisions;
+  int lo[3];
+  int hi[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    lo[j] = std::max(ijk[j] - level, 0);
+    hi[j] = std::min(ijk[j] + level, divisions[j] - 1);
+  }
+  for (int k = lo[2]; k <= hi[2]; ++k)
+  {
+    for (int j = lo[1]; j <= hi[1]; ++j)
+    {
+      for (int i = lo[0]; i <= hi[0]; ++i)
+      {
+        if (std::max({std::abs(i - ijk[0]), std::abs(j - ijk[1]),
+                      std::abs(k - ijk[2])}) == level)
+        {
+          visit(i + divisions[0] *
+                    (j + static_cast<vtkIdType>(divisions[1]) * k));
+        }
+      }
+    }
+  }
+}
+
+vtkIdType FlatLocator::FindClosestPoint(const double x[3]) const
+{
+  int ijk[3];
+  this->GetBucket(x, ijk);
+  double minH = std::min({this->H[0], this->H[1], this->H[2]});
+  auto const* divisions = this->Header->Divisions;
+  int maxLevel = std::max({divisions[0], divisions[1], divisions[2]});
+
+  vtkIdType closest = -1;
+  double closestDistance2 = VTK_DOUBLE_MAX;
+  for (int level = 0; level <= maxLevel; ++level)
+  {
+    this->VisitShell(ijk, level, [&](vtkIdType bucket) {
+      for (auto i = this->PointOffsets[bucket]; i < this->PointOffsets[bucket + 1]; ++i)
+      {
+        auto id = static_cast<vtkIdType>(this->PointIds[i]);
+        double distance2 =
+            vtkMath::Distance2BetweenPoints(x, this->DataSet->GetPoint(id));
+        if (distance2 < closestDistance2)
+        {
+          closestDistance2 = distance2;
+          closest = id;
+        }
+      }
+    });
+    // Buckets beyond this shell are at least level * minH away
+    double reach = level * minH;
+    if (closest >= 0 && closestDistance2 <= reach * reach)
+    {
+      break;
+    }
+  }
+  return closest;
+}
+
+void FlatLocator::FindClosestPoint(const double x[3], double closestPoint[3],
+                                   vtkIdType& cellId, double& dist2) const
+{
+  if (++this->Stamp == 0)
+  {
+    std::fill(this->Visited.begin(), this->Visited.end(), 0);
+    this->Stamp = 1;
+  }
+  int ijk[3];
+  this->GetBucket(x, ijk);
+  double minH = std::min({this->H[0], this->H[1], this->H[2]});
+  auto const* divisions = this->Header->Divisions;
+  int maxLevel = std::max({divisions[0], divisions[1], divisions[2]});
+
+  cellId = -1;
+  dist2 = VTK_DOUBLE_MAX;
+  double point[3];
+  double pcoords[3];
+  int subId;
+  for (int level = 0; level <= maxLevel; ++level)
+  {
+    this->VisitShell(ijk, level, [&](vtkIdType bucket) {
+      for (auto i = this->CellOffsets[bucket]; i < this->CellOffsets[bucket + 1]; ++i)
+      {
+        auto id = static_cast<vtkIdType>(this->CellIds[i]);
+        if (this->Visited[id] == this->Stamp)
+        {
+          continue;
+        }
+        this->Visited[id] = this->Stamp;
+        this->DataSet->GetCell(id, this->Cell);
+        double distance2;
+        if (this->Cell->EvaluatePosition(x, point, subId, pcoords, distance2,
+                                         this->Weights.data()) != -1 &&
+            distance2 < dist2)
+        {
+          dist2 = distance2;
+          cellId = id;
+          std::copy(point, point + 3, closestPoint);
+        }
+      }
+    });
+    // The closest point of a cell lies in a bucket its bounds overlap
+    double reach = level * minH;
+    if (cellId >= 0 && dist2 <= reach * reach)
+    {
+      break;
+    }
+  }
+}
+
+bool WriteBlob(std::string const& fileName,
+               std::vector<std::int64_t> const& blob)
+{
+  std::ofstream stream(fileName, std::ios::binary);
+  stream.write(reinterpret_cast<const char*>(blob.data()),
+               static_cast<std::streamsize>(blob.size() * sizeof(std::int64_t)));
+  return static_cast<bool>(stream);
+}
+
+#ifdef _WIN32
+MappedFile::~MappedFile() = default;
+
+bool MappedFile::Open(std::string const& fileName)
+{
+  // No mmap, read the file into an 8 byte aligned buffer instead
+  std::ifstream stream(fileName, std::ios::binary | std::ios::ate);
+  if (!stream)
+  {
+    return false;
+  }
+  auto size = static_cast<std::size_t>(stream.tellg());
+  this->Buffer.resize((size + sizeof(std::int64_t) - 1) / sizeof(std::int64_t));
+  stream.seekg(0);
+  stream.read(reinterpret_cast<char*>(this->Buffer.data()),
+              static_cast<std::streamsize>(size));
+  this->Data = this->Buffer.data();
+  this->Size = size;
+  return static_cast<bool>(stream);
+}
+#else
+MappedFile::~MappedFile()
+{
+  if (this->Data)
+  {
+    munmap(const_cast<void*>(this->Data), this->Size);
+  }
+}
+
+bool MappedFile::Open(std::string const& fileName)
+{
+  if (this->Data)
+  {
+    munmap(const_cast<void*>(this->Data), this->Size);
+    this->Data = nullptr;
+    this->Size = 0;
+  }
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size == 0)
+  {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size),
+                    PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  this->Data = data;
+  this->Size = static_cast<std::size_t>(status.st_size);
+  return true;
+}
+#endif
+} // namespace
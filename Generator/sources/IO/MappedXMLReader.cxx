@@ -0,0 +1,808 @@
+//
+// This example reads the raw appended arrays of a .vti or .vtp file in
+// place: the file is memory mapped and the arrays wrap the mapping, nothing
+// is copied. The example writes a raw appended copy of its input, and
+// compares the time and heap growth with vtkXMLImageDataReader or
+// vtkXMLPolyDataReader.
+//
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDataSet.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTypeFloat32Array.h>
+#include <vtkTypeFloat64Array.h>
+#include <vtkTypeInt16Array.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+#include <vtkTypeInt8Array.h>
+#include <vtkTypeUInt16Array.h>
+#include <vtkTypeUInt32Array.h>
+#include <vtkTypeUInt64Array.h>
+#include <vtkTypeUInt8Array.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLDataParser.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkXMLPolyDataReader.h>
+#include <vtkXMLPolyDataWriter.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__EMSCRIPTEN__) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// A whole file in memory. The mapping is private: an array modified in
+// place gets its own copy of the pages, the file is never written.
+class MappedFile
+{
+public:
+  ~MappedFile();
+  bool Open(std::string const& fileName);
+  char* GetData() const
+  {
+    return this->Data;
+  }
+  std::size_t GetSize() const
+  {
+    return this->Size;
+  }
+
+private:
+  char* Data = nullptr;
+  std::size_t Size = 0;
+#ifdef _WIN32
+  std::vector<std::int64_t> Buffer;
+#endif
+};
+
+// Every array wrapping a mapping holds a reference to it. The free function
+// of the array drops the reference, the last one unmaps the file, so the
+// mapping lives as long as any of its arrays, whatever data object holds
+// them.
+void HoldMapping(void* data, std::shared_ptr<MappedFile> const& file);
+void ReleaseMapping(void* data);
+
+// Reads a single piece .vti or .vtp file whose arrays are appended, raw and
+// uncompressed, in the byte order of the machine. The arrays wrap the file
+// mapping, an array is copied only when its values are not aligned in the
+// file.
+class MappedXMLReader
+{
+public:
+  // Null when the file is not one of those, read it with the usual reader.
+  vtkSmartPointer<vtkDataSet> Read(std::string const& fileName);
+
+  std::size_t GetWrappedBytes() const
+  {
+    return this->WrappedBytes;
+  }
+  std::size_t GetCopiedBytes() const
+  {
+    return this->CopiedBytes;
+  }
+
+private:
+  vtkSmartPointer<vtkImageData> ReadImageData(vtkXMLDataElement* image);
+  vtkSmartPointer<vtkPolyData> ReadPolyData(vtkXMLDataElement* polydata);
+  bool ReadAttributes(vtkXMLDataElement* piece, const char* name,
+                      vtkIdType numberOfTuples,
+                      vtkDataSetAttributes* attributes);
+  vtkSmartPointer<vtkCellArray> ReadCells(vtkXMLDataElement* piece,
+                                          const char* name,
+                                          vtkIdType numberOfCells);
+  vtkSmartPointer<vtkDataArray> ReadArray(vtkXMLDataElement* element,
+                                          vtkIdType numberOfTuples);
+
+  std::shared_ptr<MappedFile> File;
+  const char* Appended = nullptr;
+  bool UInt64Header = false;
+  std::size_t WrappedBytes = 0;
+  std::size_t CopiedBytes = 0;
+};
+
+// Malloc heap in use, 0 where it cannot be measured
+std::size_t HeapInUse();
+
+// Growth of the heap since before
+std::size_t HeapGrowth(std::size_t before);
+
+// Values of a and b that differ, all of them when the sizes differ
+vtkIdType CountDifferences(vtkDataArray* a, vtkDataArray* b);
+
+// Differences between the arrays and cells of the two data sets
+vtkIdType CountDifferences(vtkDataSet* a, vtkDataSet* b);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " file.vti|file.vtp [raw copy]"
+              << std::endl;
+    std::cout << "e.g. vase.vti" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string fileName = argv[1];
+  auto dot = fileName.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : fileName.substr(dot);
+  if (extension != ".vti" && extension != ".vtp")
+  {
+    std::cout << "Expected a .vti or .vtp file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string rawName =
+      argc > 2 ? argv[2] : fileName.substr(0, dot) + ".raw" + extension;
+  bool isImage = extension == ".vti";
+
+  // The copy the mapped reader can read: appended, raw, uncompressed
+  if (isImage)
+  {
+    vtkNew<vtkXMLImageDataReader> reader;
+    reader->SetFileName(fileName.c_str());
+    vtkNew<vtkXMLImageDataWriter> writer;
+    writer->SetInputConnection(reader->GetOutputPort());
+    writer->SetFileName(rawName.c_str());
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetCompressorTypeToNone();
+    writer->SetHeaderTypeToUInt64();
+    writer->Write();
+  }
+  else
+  {
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->SetFileName(fileName.c_str());
+    vtkNew<vtkXMLPolyDataWriter> writer;
+    writer->SetInputConnection(reader->GetOutputPort());
+    writer->SetFileName(rawName.c_str());
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetCompressorTypeToNone();
+    writer->SetHeaderTypeToUInt64();
+    writer->Write();
+  }
+
+  vtkNew<vtkTimerLog> timer;
+  std::size_t before = HeapInUse();
+  timer->StartTimer();
+  vtkSmartPointer<vtkDataSet> expected;
+  if (isImage)
+  {
+    vtkNew<vtkXMLImageDataReader> reader;
+    reader->SetFileName(rawName.c_str());
+    reader->Update();
+    expected = reader->GetOutput();
+  }
+  else
+  {
+    vtkNew<vtkXMLPolyDataReader> reader;
+    reader->SetFileName(rawName.c_str());
+    reader->Update();
+    expected = reader->GetOutput();
+  }
+  timer->StopTimer();
+  double readerTime = timer->GetElapsedTime();
+  double readerHeap = HeapGrowth(before) / 1.0e6;
+
+  MappedXMLReader mappedReader;
+  before = HeapInUse();
+  timer->StartTimer();
+  auto mapped = mappedReader.Read(rawName);
+  timer->StopTimer();
+  if (!mapped)
+  {
+    std::cout << rawName << " cannot be mapped" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double mappedTime = timer->GetElapsedTime();
+  double mappedHeap = HeapGrowth(before) / 1.0e6;
+
+  std::cout << rawName << ": " << mapped->GetNumberOfPoints() << " points, "
+            << mapped->GetNumberOfCells() << " cells, "
+            << mappedReader.GetWrappedBytes() / 1.0e6 << " MB wrapped, "
+            << mappedReader.GetCopiedBytes() / 1.0e6 << " MB copied"
+            << std::endl;
+  std::cout << "reader,seconds,heap_MB" << std::endl;
+  std::cout << (isImage ? "vtkXMLImageDataReader," : "vtkXMLPolyDataReader,")
+            << readerTime << "," << readerHeap << std::endl;
+  std::cout << "MappedXMLReader," << mappedTime << "," << mappedHeap
+            << std::endl;
+
+  auto differences = CountDifferences(expected, mapped);
+  std::cout << differences << " values differ from the XML reader"
+            << std::endl;
+
+  return differences == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+#ifdef _WIN32
+MappedFile::~MappedFile() = default;
+
+bool MappedFile::Open(std::string const& fileName)
+{
+  // No mmap, read the file into an 8 byte aligned buffer instead
+  std::ifstream stream(fileName, std::ios::binary | std::ios::ate);
+  if (!stream)
+  {
+    return false;
+  }
+  auto size = static_cast<std::size_t>(stream.tellg());
+  this->Buffer.resize((size + sizeof(std::int64_t) - 1) / sizeof(std::int64_t));
+  stream.seekg(0);
+  stream.read(reinterpret_cast<char*>(this->Buffer.data()),
+              static_cast<std::streamsize>(size));
+  this->Data = reinterpret_cast<char*>(this->Buffer.data());
+  this->Size = size;
+  return static_cast<bool>(stream);
+}
+#else
+MappedFile::~MappedFile()
+{
+  if (this->Data)
+  {
+    munmap(this->Data, this->Size);
+  }
+}
+
+bool MappedFile::Open(std::string const& fileName)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || status.st_size == 0)
+  {
+    close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  this->Data = static_cast<char*>(data);
+  this->Size = static_cast<std::size_t>(status.st_size);
+  return true;
+}
+#endif
+
+// The free function of an array gets its pointer only: the references are
+// kept by pointer. Never destroyed, arrays may be freed at exit.
+std::mutex& MappingsMutex()
+{
+  static auto mutex = new std::mutex;
+  return *mutex;
+}
+
+std::multimap<void*, std::shared_ptr<MappedFile>>& Mappings()
+{
+  static auto mappings = new std::multimap<void*, std::shared_ptr<MappedFile>>;
+  return *mappings;
+}
+
+void HoldMapping(void* data, std::shared_ptr<MappedFile> const& file)
+{
+  std::lock_guard<std::mutex> lock(MappingsMutex());
+  Mappings().emplace(data, file);
+}
+
+void ReleaseMapping(void* data)
+{
+  std::shared_ptr<MappedFile> file;
+  {
+    std::lock_guard<std::mutex> lock(MappingsMutex());
+    auto it = Mappings().find(data);
+    if (it == Mappings().end())
+    {
+      return;
+    }
+    file = it->second;
+    Mappings().erase(it);
+  }
+  // The last reference, if it is, unmaps outside of the lock
+}
+
+vtkSmartPointer<vtkDataArray> NewArray(const char* type)
+{
+  std::string name = type ? type : "";
+  if (name == "Int8")
+  {
+    return vtkSmartPointer<vtkTypeInt8Array>::New();
+  }
+  if (name == "UInt8")
+  {
+    return vtkSmartPointer<vtkTypeUInt8Array>::New();
+  }
+  if (name == "Int16")
+  {
+    return vtkSmartPointer<vtkTypeInt16Array>::New();
+  }
+  if (name == "UInt16")
+  {
+    return vtkSmartPointer<vtkTypeUInt16Array>::New();
+  }
+  if (name == "Int32")
+  {
+    return vtkSmartPointer<vtkTypeInt32Array>::New();
+  }
+  if (name == "UInt32")
+  {
+    return vtkSmartPointer<vtkTypeUInt32Array>::New();
+  }
+  if (name == "Int64")
+  {
+    return vtkSmartPointer<vtkTypeInt64Array>::New();
+  }
+  if (name == "UInt64")
+  {
+    return vtkSmartPointer<vtkTypeUInt64Array>::New();
+  }
+  if (name == "Float32")
+  {
+    return vtkSmartPointer<vtkTypeFloat32Array>::New();
+  }
+  if (name == "Float64")
+  {
+    return vtkSmartPointer<vtkTypeFloat64Array>::New();
+  }
+  return nullptr;
+}
+
+vtkSmartPointer<vtkDataSet> MappedXMLReader::Read(std::string const& fileName)
+{
+  this->WrappedBytes = 0;
+  this->CopiedBytes = 0;
+
+  // The XML part only, the parser stops where the appended data start.
+  vtkNew<vtkXMLDataParser> parser;
+  parser->SetFileName(fileName.c_str());
+  if (!parser->Parse())
+  {
+    return nullptr;
+  }
+  auto root = parser->GetRootElement();
+  auto appended = root->FindNestedElementWithName("AppendedData");
+  const char* encoding = appended ? appended->GetAttribute("encoding") : nullptr;
+  if (!encoding || std::strcmp(encoding, "raw") != 0 ||
+      root->GetAttribute("compressor"))
+  {
+    return nullptr;
+  }
+  const char* byteOrder = root->GetAttribute("byte_order");
+#ifdef VTK_WORDS_BIGENDIAN
+  const char* nativeOrder = "BigEndian";
+#else
+  const char* nativeOrder = "LittleEndian";
+#endif
+  if (!byteOrder || std::strcmp(byteOrder, nativeOrder) != 0)
+  {
+    return nullptr;
+  }
+  const char* headerType = root->GetAttribute("header_type");
+  this->UInt64Header = headerType && std::strcmp(headerType, "UInt64") == 0;
+
+  this->File = std::make_shared<MappedFile>();
+  if (!this->File->Open(fileName) ||
+      parser->GetAppendedDataPosition() >
+          static_cast<vtkTypeInt64>(this->File->GetSize()))
+  {
+    this->File.reset();
+    return nullptr;
+  }
+  this->Appended = this->File->GetData() + parser->GetAppendedDataPosition();
+
+  vtkSmartPointer<vtkDataSet> output;
+  const char* type = root->GetAttribute("type");
+  if (type && std::strcmp(type, "ImageData") == 0)
+  {
+    output = this->ReadImageData(root->FindNestedElementWithName("ImageData"));
+  }
+  else if (type && std::strcmp(type, "PolyData") == 0)
+  {
+    output = this->ReadPolyData(root->FindNestedElementWithName("PolyData"));
+  }
+  // The arrays hold the mapping now, if any was made
+  this->File.reset();
+  return output;
+}
+
+// The only Piece of a data set element
+vtkXMLDataElement* SinglePiece(vtkXMLDataElement* element)
+{
+  vtkXMLDataElement* piece = nullptr;
+  for (int i = 0; element && i < element->GetNumberOfNestedElements(); ++i)
+  {
+    auto nested = element->GetNestedElement(i);
+    if (std::strcmp(nested->GetName(), "Piece") == 0)
+    {
+      if (piece)
+      {
+        return nullptr;
+      }
+      piece = nested;
+    }
+  }
+  return piece;
+}
+
+vtkSmartPointer<vtkImageData> MappedXMLReader::ReadImageData(
+    vtkXMLDataElement* image)
+{
+  auto piece = SinglePiece(image);
+  int extent[6];
+  if (!piece || piece->GetVectorAttribute("Extent", 6, extent) != 6)
+  {
+    return nullptr;
+  }
+  auto output = vtkSmartPointer<vtkImageData>::New();
+  output->SetExtent(extent);
+  double origin[3] = {0.0, 0.0, 0.0};
+  double spacing[3] = {1.0, 1.0, 1.0};
+  double direction[9] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  image->GetVectorAttribute("Origin", 3, origin);
+  image->GetVectorAttribute("Spacing", 3, spacing);
+  image->GetVectorAttribute("Direction", 9, direction);
+  output->SetOrigin(origin);
+  output->SetSpacing(spacing);
+  output->SetDirectionMatrix(direction);
+  if (!this->ReadAttributes(piece, "PointData", output->GetNumberOfPoints(),
+                            output->GetPointData()) ||
+      !this->ReadAttributes(piece, "CellData", output->GetNumberOfCells(),
+                            output->GetCellData()))
+  {
+    return nullptr;
+  }
+  return output;
+}
+
+vtkSmartPointer<vtkPolyData> MappedXMLReader::ReadPolyData(
+    vtkXMLDataElement* polydata)
+{
+  auto piece = SinglePiece(polydata);
+  vtkIdType numberOfPoints = 0;
+  if (!piece || !piece->GetScalarAttribute("NumberOfPoints", numberOfPoints))
+  {
+    return nullptr;
+  }
+  auto output = vtkSmartPointer<vtkPolyData>::New();
+  if (numberOfPoints > 0)
+  {
+    auto pointsElement = piece->FindNestedElementWithName("Points");
+    auto coordinates = pointsElement
+        ? this->ReadArray(pointsElement->FindNestedElementWithName("DataArray"),
+                          numberOfPoints)
+        : nullptr;
+    if (!coordinates || coordinates->GetNumberOfComponents() != 3)
+    {
+      return nullptr;
+    }
+    vtkNew<vtkPoints> points;
+    points->SetData(coordinates);
+    output->SetPoints(points);
+  }
+
+  // vtkPolyData numbers the verts, then the lines, the polys and the strips.
+  const char* kinds[] = {"Verts", "Lines", "Polys", "Strips"};
+  vtkIdType numberOfCells = 0;
+  for (const char* kind : kinds)
+  {
+    vtkIdType count = 0;
+    piece->GetScalarAttribute((std::string("NumberOf") + kind).c_str(), count);
+    auto cells = this->ReadCells(piece, kind, count);
+    if (!cells)
+    {
+      return nullptr;
+    }
+    numberOfCells += count;
+    if (count == 0)
+    {
+      continue;
+    }
+    if (std::strcmp(kind, "Verts") == 0)
+    {
+      output->SetVerts(cells);
+    }
+    else if (std::strcmp(kind, "Lines") == 0)
+    {
+      output->SetLines(cells);
+    }
+    else if (std::strcmp(kind, "Polys") == 0)
+    {
+      output->SetPolys(cells);
+    }
+    else
+    {
+      output->SetStrips(cells);
+    }
+  }
+
+  if (!this->ReadAttributes(piece, "PointData", numberOfPoints,
+                            output->GetPointData()) ||
+      !this->ReadAttributes(piece, "CellData", numberOfCells,
+                            output->GetCellData()))
+  {
+    return nullptr;
+  }
+  return output;
+}
+
+bool MappedXMLReader::ReadAttributes(vtkXMLDataElement* piece,
+                                     const char* name,
+                                     vtkIdType numberOfTuples,
+                                     vtkDataSetAttributes* attributes)
+{
+  auto element = piece->FindNestedElementWithName(name);
+  if (!element)
+  {
+    return true;
+  }
+  for (int i = 0; i < element->GetNumberOfNestedElements(); ++i)
+  {
+    auto array = this->ReadArray(element->GetNestedElement(i), numberOfTuples);
+    if (!array)
+    {
+      return false;
+    }
+    attributes->AddArray(array);
+  }
+  const char* names[] = {"Scalars", "Vectors", "Normals", "TCoords",
+                         "Tensors"};
+  const int types[] = {vtkDataSetAttributes::SCALARS,
+                       vtkDataSetAttributes::VECTORS,
+                       vtkDataSetAttributes::NORMALS,
+                       vtkDataSetAttributes::TCOORDS,
+                       vtkDataSetAttributes::TENSORS};
+  for (int i = 0; i < 5; ++i)
+  {
+    if (const char* active = element->GetAttribute(names[i]))
+    {
+      attributes->SetActiveAttribute(active, types[i]);
+    }
+  }
+  return true;
+}
+
+vtkSmartPointer<vtkCellArray> MappedXMLReader::ReadCells(
+    vtkXMLDataElement* piece, const char* name, vtkIdType numberOfCells)
+{
+  auto cells = vtkSmartPointer<vtkCellArray>::New();
+  if (numberOfCells == 0)
+  {
+    return cells;
+  }
+  auto element = piece->FindNestedElementWithName(name);
+  if (!element)
+  {
+    return nullptr;
+  }
+  auto ends = this->ReadArray(element->FindNestedElementWithNameAndAttribute(
+                                  "DataArray", "Name", "offsets"),
+                              numberOfCells);
+  if (!ends)
+  {
+    return nullptr;
+  }
+  auto connectivity = this->ReadArray(
+      element->FindNestedElementWithNameAndAttribute("DataArray", "Name",
+                                                     "connectivity"),
+      static_cast<vtkIdType>(ends->GetComponent(numberOfCells - 1, 0)));
+  if (!connectivity)
+  {
+    return nullptr;
+  }
+  // The file has the end of every cell, vtkCellArray wants a leading 0: the
+  // offsets are the one copy, a value per cell.
+  auto offsets = vtkSmartPointer<vtkDataArray>::Take(connectivity->NewInstance());
+  offsets->SetNumberOfTuples(numberOfCells + 1);
+  offsets->SetComponent(0, 0, 0.0);
+  offsets->InsertTuples(1, numberOfCells, 0, ends);
+  this->CopiedBytes +=
+      static_cast<std::size_t>(numberOfCells + 1) * offsets->GetDataTypeSize();
+  if (!cells->SetData(offsets, connectivity))
+  {
+    return nullptr;
+  }
+  return cells;
+}
+
+vtkSmartPointer<vtkDataArray> MappedXMLReader::ReadArray(
+    vtkXMLDataElement* element, vtkIdType numberOfTuples)
+{
+  const char* format = element ? element->GetAttribute("format") : nullptr;
+  vtkIdType offset = 0;
+  if (!format || std::strcmp(format, "appended") != 0 ||
+      !element->GetScalarAttribute("offset", offset))
+  {
+    return nullptr;
+  }
+  auto array = NewArray(element->GetAttribute("type"));
+  if (!array)
+  {
+    return nullptr;
+  }
+  int numberOfComponents = 1;
+  element->GetScalarAttribute("NumberOfComponents", numberOfComponents);
+  array->SetNumberOfComponents(numberOfComponents);
+  array->SetName(element->GetAttribute("Name"));
+
+  // A block is its size in bytes, then the values.
+  const char* block = this->Appended + offset;
+  std::size_t headerSize = this->UInt64Header ? 8 : 4;
+  auto end = this->File->GetData() + this->File->GetSize();
+  if (block + headerSize > end)
+  {
+    return nullptr;
+  }
+  std::uint64_t blockSize = 0;
+  if (this->UInt64Header)
+  {
+    std::memcpy(&blockSize, block, 8);
+  }
+  else
+  {
+    std::uint32_t size32;
+    std::memcpy(&size32, block, 4);
+    blockSize = size32;
+  }
+  vtkIdType numberOfValues = numberOfTuples * numberOfComponents;
+  auto size = static_cast<std::size_t>(numberOfValues) * array->GetDataTypeSize();
+  char* values = const_cast<char*>(block) + headerSize;
+  if (blockSize < size || values + size > end)
+  {
+    return nullptr;
+  }
+
+  if (reinterpret_cast<std::uintptr_t>(values) % array->GetDataTypeSize() == 0)
+  {
+    array->SetVoidArray(values, numberOfValues, 1,
+                        vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+    array->SetArrayFreeFunction(ReleaseMapping);
+    HoldMapping(values, this->File);
+    this->WrappedBytes += size;
+  }
+  else
+  {
+    // Misaligned values cannot be used in place
+    array->SetNumberOfTuples(numberOfTuples);
+    std::memcpy(array->GetVoidPointer(0), values, size);
+    this->CopiedBytes += size;
+  }
+  return array;
+}
+
+std::size_t HeapInUse()
+{
+#if defined(__EMSCRIPTEN__)
+  return static_cast<std::size_t>(static_cast<unsigned int>(mallinfo().uordblks));
+#elif defined(__GLIBC__) &&                                                    \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  // Large blocks are mapped apart (hblkhd)
+  auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+std::size_t HeapGrowth(std::size_t before)
+{
+  std::size_t after = HeapInUse();
+  return after > before ? after - before : 0;
+}
+
+vtkIdType CountDifferences(vtkDataArray* a, vtkDataArray* b)
+{
+  if (!a || !b)
+  {
+    return a == b ? 0 : 1;
+  }
+  if (a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+  {
+    return std::max<vtkIdType>(1, a->GetNumberOfValues());
+  }
+  vtkIdType differences = 0;
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); ++i)
+  {
+    for (int j = 0; j < a->GetNumberOfComponents(); ++j)
+    {
+      if (a->GetComponent(i, j) != b->GetComponent(i, j))
+      {
+        ++differences;
+      }
+    }
+  }
+  return differences;
+}
+
+vtkIdType CountDifferences(vtkDataSet* a, vtkDataSet* b)
+{
+  vtkIdType differences = 0;
+  for (int kind = 0; kind < 2; ++kind)
+  {
+    vtkDataSetAttributes* aAttributes = kind == 0
+        ? static_cast<vtkDataSetAttributes*>(a->GetPointData())
+        : a->GetCellData();
+    vtkDataSetAttributes* bAttributes = kind == 0
+        ? static_cast<vtkDataSetAttributes*>(b->GetPointData())
+        : b->GetCellData();
+    for (int i = 0; i < aAttributes->GetNumberOfArrays(); ++i)
+    {
+      auto array = aAttributes->GetArray(i);
+      if (!array)
+      {
+        continue;
+      }
+      differences +=
+          CountDifferences(array, bAttributes->GetArray(array->GetName()));
+    }
+    if (aAttributes->GetScalars() &&
+        (!bAttributes->GetScalars() ||
+         std::strcmp(aAttributes->GetScalars()->GetName(),
+                     bAttributes->GetScalars()->GetName()) != 0))
+    {
+      ++differences;
+    }
+  }
+
+  auto aPolyData = vtkPolyData::SafeDownCast(a);
+  auto bPolyData = vtkPolyData::SafeDownCast(b);
+  if (aPolyData && bPolyData)
+  {
+    differences += CountDifferences(aPolyData->GetPoints()
+                                        ? aPolyData->GetPoints()->GetData()
+                                        : nullptr,
+                                    bPolyData->GetPoints()
+                                        ? bPolyData->GetPoints()->GetData()
+                                        : nullptr);
+    vtkCellArray* aCells[] = {aPolyData->GetVerts(), aPolyData->GetLines(),
+                              aPolyData->GetPolys(), aPolyData->GetStrips()};
+    vtkCellArray* bCells[] = {bPolyData->GetVerts(), bPolyData->GetLines(),
+                              bPolyData->GetPolys(), bPolyData->GetStrips()};
+    for (int i = 0; i < 4; ++i)
+    {
+      differences += CountDifferences(aCells[i]->GetOffsetsArray(),
+                                      bCells[i]->GetOffsetsArray());
+      differences += CountDifferences(aCells[i]->GetConnectivityArray(),
+                                      bCells[i]->GetConnectivityArray());
+    }
+  }
+  else if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+           a->GetNumberOfCells() != b->GetNumberOfCells())
+  {
+    ++differences;
+  }
+  return differences;
+}
+} // namespace
@@ -0,0 +1,437 @@
+//
+// This example compresses the appended data of a .vti file with a pool of
+// threads. The XML format compresses an array in independent blocks, so the
+// blocks can be compressed, and decompressed, at the same time. The example
+// writes files vtkXMLImageDataReader reads, and compares the throughput of
+// each codec and thread count with vtkXMLImageDataWriter.
+//
+#include <vtkDataArray.h>
+#include <vtkDataCompressor.h>
+#include <vtkImageData.h>
+#include <vtkLZ4DataCompressor.h>
+#include <vtkLZMADataCompressor.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkRTAnalyticSource.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkZLibDataCompressor.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+// The blocks of an array as the appended data store them: a header of
+// UInt64, the number of blocks, the size of a block, the size of the last
+// block when it is partial (else 0) and the compressed size of each block,
+// then the compressed blocks.
+struct CompressedArray
+{
+  std::vector<std::uint64_t> Header;
+  std::vector<std::vector<unsigned char>> Blocks;
+
+  std::size_t GetSize() const;
+};
+
+// Compresses and decompresses the blocks of an array with vtkSMPTools. Each
+// thread has its own compressor, a new instance of the prototype.
+class ParallelBlockCodec
+{
+public:
+  ParallelBlockCodec(vtkDataCompressor* prototype, std::size_t blockSize)
+    : Prototype(prototype), BlockSize(blockSize)
+  {
+  }
+
+  bool Compress(const unsigned char* data, std::size_t size,
+                CompressedArray& compressed);
+
+  // Decompresses every block in place in data, of the uncompressed size
+  bool Decompress(CompressedArray const& compressed, unsigned char* data,
+                  std::size_t size);
+
+  const char* GetCompressorName() const
+  {
+    return this->Prototype->GetClassName();
+  }
+
+private:
+  vtkDataCompressor* GetLocalCompressor();
+
+  vtkSmartPointer<vtkDataCompressor> Prototype;
+  std::size_t BlockSize;
+  vtkSMPThreadLocal<vtkSmartPointer<vtkDataCompressor>> Compressors;
+};
+
+// Writes the point data of image as a .vti file with compressed appended
+// data, the blocks compressed by codec
+bool WriteImageData(vtkImageData* image, std::string const& fileName,
+                    ParallelBlockCodec& codec);
+
+// Values of a and b that differ, all of them when the sizes differ
+vtkIdType CountDifferences(vtkDataArray* a, vtkDataArray* b);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: ParallelBlockCompression [image size] [output prefix]
+  int size = 128;
+  std::string prefix = "ParallelBlockCompression";
+  if (argc > 1)
+  {
+    size = std::max(2, std::atoi(argv[1]));
+  }
+  if (argc > 2)
+  {
+    prefix = argv[2];
+  }
+
+  // A smooth field, as a simulation writes
+  vtkNew<vtkRTAnalyticSource> source;
+  int half = size / 2;
+  source->SetWholeExtent(-half, size - half - 1, -half, size - half - 1, -half,
+                         size - half - 1);
+  source->Update();
+  auto image = source->GetOutput();
+  auto scalars = image->GetPointData()->GetScalars();
+  auto data = static_cast<unsigned char*>(scalars->GetVoidPointer(0));
+  std::size_t bytes = scalars->GetNumberOfValues() * scalars->GetDataTypeSize();
+  double megabytes = bytes / 1.0e6;
+
+  // The block size of vtkXMLWriter
+  const std::size_t blockSize = 32768;
+  int maxThreads = vtkSMPTools::GetEstimatedNumberOfThreads();
+  std::cout << size << "^3 image, " << megabytes << " MB, "
+            << vtkSMPTools::GetBackend() << " backend, up to " << maxThreads
+            << " threads" << std::endl;
+  std::cout << "codec,threads,ratio,compress_MB_per_s,decompress_MB_per_s"
+            << std::endl;
+
+  vtkSmartPointer<vtkDataCompressor> compressors[] = {
+      vtkSmartPointer<vtkZLibDataCompressor>::New(),
+      vtkSmartPointer<vtkLZ4DataCompressor>::New(),
+      vtkSmartPointer<vtkLZMADataCompressor>::New()};
+  vtkNew<vtkTimerLog> timer;
+  vtkIdType differences = 0;
+  std::vector<unsigned char> decompressed(bytes);
+  for (auto const& compressor : compressors)
+  {
+    // One block after the other, as the XML writer and reader do
+    vtkNew<vtkXMLImageDataWriter> writer;
+    writer->SetInputData(image);
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetHeaderTypeToUInt64();
+    writer->SetCompressor(compressor);
+    writer->SetBlockSize(blockSize);
+    writer->WriteToOutputStringOn();
+    timer->StartTimer();
+    writer->Write();
+    timer->StopTimer();
+    double writerTime = timer->GetElapsedTime();
+
+    vtkNew<vtkXMLImageDataReader> reader;
+    reader->ReadFromInputStringOn();
+    reader->SetInputString(writer->GetOutputString());
+    timer->StartTimer();
+    reader->Update();
+    timer->StopTimer();
+    double readerTime = timer->GetElapsedTime();
+    std::cout << compressor->GetClassName() << ",xml,"
+              << bytes / static_cast<double>(writer->GetOutputString().size())
+              << "," << megabytes / writerTime << "," << megabytes / readerTime
+              << std::endl;
+
+    ParallelBlockCodec codec(compressor, blockSize);
+    CompressedArray compressed;
+    for (int threads = 1;; threads = std::min(2 * threads, maxThreads))
+    {
+      vtkSMPTools::Initialize(threads);
+      timer->StartTimer();
+      bool compressedOk = codec.Compress(data, bytes, compressed);
+      timer->StopTimer();
+      double compressTime = timer->GetElapsedTime();
+
+      timer->StartTimer();
+      bool decompressedOk =
+          codec.Decompress(compressed, decompressed.data(), bytes);
+      timer->StopTimer();
+      double decompressTime = timer->GetElapsedTime();
+      if (!compressedOk || !decompressedOk ||
+          !std::equal(decompressed.begin(), decompressed.end(), data))
+      {
+        std::cout << compressor->GetClassName() << " failed with " << threads
+                  << " threads" << std::endl;
+        return EXIT_FAILURE;
+      }
+      std::cout << compressor->GetClassName() << "," << threads << ","
+                << bytes / static_cast<double>(compressed.GetSize()) << ","
+                << megabytes / compressTime << ","
+                << megabytes / decompressTime << std::endl;
+      if (threads == maxThreads)
+      {
+        break;
+      }
+    }
+
+    // The files are the ones of vtkXMLImageDataWriter.
+    std::string fileName =
+        prefix + "_" + compressor->GetClassName() + ".vti";
+    if (!WriteImageData(image, fileName, codec))
+    {
+      std::cout << "Cannot write " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    vtkNew<vtkXMLImageDataReader> fileReader;
+    fileReader->SetFileName(fileName.c_str());
+    fileReader->Update();
+    differences += CountDifferences(
+        scalars, fileReader->GetOutput()->GetPointData()->GetScalars());
+  }
+  std::cout << differences
+            << " values differ in the files read by vtkXMLImageDataReader"
+            << std::endl;
+
+  return differences == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+std::size_t CompressedArray::GetSize() const
+{
+  std::size_t size = this->Header.size() * sizeof(std::uint64_t);
+  for (auto const& block : this->Blocks)
+  {
+    size += block.size();
+  }
+  return size;
+}
+
+vtkDataCompressor* ParallelBlockCodec::GetLocalCompressor()
+{
+  auto& compressor = this->Compressors.Local();
+  if (!compressor)
+  {
+    compressor.TakeReference(this->Prototype->NewInstance());
+    compressor->SetCompressionLevel(this->Prototype->GetCompressionLevel());
+  }
+  return compressor;
+}
+
+bool ParallelBlockCodec::Compress(const unsigned char* data, std::size_t size,
+                                  CompressedArray& compressed)
+{
+  std::size_t numberOfBlocks = (size + this->BlockSize - 1) / this->BlockSize;
+  std::size_t lastBlockSize = size % this->BlockSize;
+  compressed.Header.assign(3 + numberOfBlocks, 0);
+  compressed.Header[0] = numberOfBlocks;
+  compressed.Header[1] = this->BlockSize;
+  compressed.Header[2] = lastBlockSize;
+  compressed.Blocks.resize(numberOfBlocks);
+
+  std::atomic<bool> ok(true);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numberOfBlocks),
+                   [&](vtkIdType begin, vtkIdType end) {
+                     auto compressor = this->GetLocalCompressor();
+                     for (vtkIdType i = begin; i < end; ++i)
+                     {
+                       std::size_t offset = i * this->BlockSize;
+                       std::size_t length =
+                           std::min(this->BlockSize, size - offset);
+                       auto& block = compressed.Blocks[i];
+                       block.resize(
+                           compressor->GetMaximumCompressionSpace(length));
+                       std::size_t blockSize = compressor->Compress(
+                           data + offset, length, block.data(), block.size());
+                       if (blockSize == 0)
+                       {
+                         ok = false;
+                       }
+                       block.resize(blockSize);
+                       compressed.Header[3 + i] = blockSize;
+                     }
+                   });
+  return ok;
+}
+
+bool ParallelBlockCodec::Decompress(CompressedArray const& compressed,
+                                    unsigned char* data, std::size_t size)
+{
+  std::size_t numberOfBlocks = compressed.Header[0];
+  std::size_t blockSize = compressed.Header[1];
+  if (numberOfBlocks != compressed.Blocks.size() ||
+      numberOfBlocks * blockSize < size ||
+      (numberOfBlocks > 0 && (numberOfBlocks - 1) * blockSize >= size))
+  {
+    return false;
+  }
+  std::atomic<bool> ok(true);
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numberOfBlocks),
+                   [&](vtkIdType begin, vtkIdType end) {
+                     auto compressor = this->GetLocalCompressor();
+                     for (vtkIdType i = begin; i < end; ++i)
+                     {
+                       std::size_t offset = i * blockSize;
+                       std::size_t length = std::min(blockSize, size - offset);
+                       auto const& block = compressed.Blocks[i];
+                       if (compressor->Uncompress(block.data(), block.size(),
+                                                  data + offset,
+                                                  length) != length)
+                       {
+                         ok = false;
+                       }
+                     }
+                   });
+  return ok;
+}
+
+// The XML name of the type of an array
+const char* TypeName(vtkDataArray* array)
+{
+  switch (array->GetDataType())
+  {
+    case VTK_SIGNED_CHAR:
+    case VTK_CHAR:
+      return "Int8";
+    case VTK_UNSIGNED_CHAR:
+      return "UInt8";
+    case VTK_SHORT:
+      return "Int16";
+    case VTK_UNSIGNED_SHORT:
+      return "UInt16";
+    case VTK_INT:
+      return "Int32";
+    case VTK_UNSIGNED_INT:
+      return "UInt32";
+    case VTK_LONG_LONG:
+    case VTK_ID_TYPE:
+      return array->GetDataTypeSize() == 8 ? "Int64" : "Int32";
+    case VTK_UNSIGNED_LONG_LONG:
+      return "UInt64";
+    case VTK_FLOAT:
+      return "Float32";
+    case VTK_DOUBLE:
+      return "Float64";
+    default:
+      return nullptr;
+  }
+}
+
+bool WriteImageData(vtkImageData* image, std::string const& fileName,
+                    ParallelBlockCodec& codec)
+{
+  // Every array compressed first, their offsets are in the XML
+  auto pointData = image->GetPointData();
+  std::vector<vtkDataArray*> arrays;
+  std::vector<CompressedArray> compressed;
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    auto array = pointData->GetArray(i);
+    if (!array || !TypeName(array))
+    {
+      continue;
+    }
+    arrays.push_back(array);
+    compressed.emplace_back();
+    std::size_t size = array->GetNumberOfValues() * array->GetDataTypeSize();
+    if (!codec.Compress(static_cast<unsigned char*>(array->GetVoidPointer(0)),
+                        size, compressed.back()))
+    {
+      return false;
+    }
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+#ifdef VTK_WORDS_BIGENDIAN
+  const char* byteOrder = "BigEndian";
+#else
+  const char* byteOrder = "LittleEndian";
+#endif
+  file.precision(17);
+  int* extent = image->GetExtent();
+  double* origin = image->GetOrigin();
+  double* spacing = image->GetSpacing();
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"ImageData\" version=\"1.0\" "
+       << "byte_order=\"" << byteOrder << "\" header_type=\"UInt64\" "
+       << "compressor=\"" << codec.GetCompressorName() << "\">\n";
+  file << "  <ImageData WholeExtent=\"" << extent[0] << " " << extent[1]
+       << " " << extent[2] << " " << extent[3] << " " << extent[4] << " "
+       << extent[5] << "\" Origin=\"" << origin[0] << " " << origin[1] << " "
+       << origin[2] << "\" Spacing=\"" << spacing[0] << " " << spacing[1]
+       << " " << spacing[2] << "\">\n";
+  file << "  <Piece Extent=\"" << extent[0] << " " << extent[1] << " "
+       << extent[2] << " " << extent[3] << " " << extent[4] << " "
+       << extent[5] << "\">\n";
+  file << "    <PointData";
+  if (pointData->GetScalars() && pointData->GetScalars()->GetName())
+  {
+    file << " Scalars=\"" << pointData->GetScalars()->GetName() << "\"";
+  }
+  file << ">\n";
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < arrays.size(); ++i)
+  {
+    file << "      <DataArray type=\"" << TypeName(arrays[i]) << "\" Name=\""
+         << (arrays[i]->GetName() ? arrays[i]->GetName() : "") << "\" "
+         << "NumberOfComponents=\"" << arrays[i]->GetNumberOfComponents()
+         << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+    offset += compressed[i].GetSize();
+  }
+  file << "    </PointData>\n"
+       << "    <CellData>\n"
+       << "    </CellData>\n"
+       << "  </Piece>\n"
+       << "  </ImageData>\n"
+       << "  <AppendedData encoding=\"raw\">\n"
+       << "   _";
+  for (auto const& array : compressed)
+  {
+    file.write(reinterpret_cast<const char*>(array.Header.data()),
+               static_cast<std::streamsize>(array.Header.size() *
+                                            sizeof(std::uint64_t)));
+    for (auto const& block : array.Blocks)
+    {
+      file.write(reinterpret_cast<const char*>(block.data()),
+                 static_cast<std::streamsize>(block.size()));
+    }
+  }
+  file << "\n  </AppendedData>\n"
+       << "</VTKFile>\n";
+  return static_cast<bool>(file);
+}
+
+vtkIdType CountDifferences(vtkDataArray* a, vtkDataArray* b)
+{
+  if (!a || !b || a->GetNumberOfTuples() != b->GetNumberOfTuples() ||
+      a->GetNumberOfComponents() != b->GetNumberOfComponents())
+  {
+    return a ? std::max<vtkIdType>(1, a->GetNumberOfValues()) : 1;
+  }
+  vtkIdType differences = 0;
+  for (vtkIdType i = 0; i < a->GetNumberOfTuples(); ++i)
+  {
+    for (int j = 0; j < a->GetNumberOfComponents(); ++j)
+    {
+      if (a->GetComponent(i, j) != b->GetComponent(i, j))
+      {
+        ++differences;
+      }
+    }
+  }
+  return differences;
+}
+} // namespace
@@ -0,0 +1,595 @@
+//
+// This example reads a series of DICOM images with a pool of threads. Each
+// thread reads the pixel data of whole slices straight into the scalars of
+// the volume. The example compares the read times with vtkDICOMImageReader
+// for 1, 2, 4, ... threads, and checks the volumes are the same.
+//
+#include <vtkByteSwap.h>
+#include <vtkDICOMImageReader.h>
+#include <vtkDataArray.h>
+#include <vtkDirectory.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+// Where the pixels of a slice are, and how they are stored
+struct SliceHeader
+{
+  std::string FileName;
+  int Columns = 0;
+  int Rows = 0;
+  int SamplesPerPixel = 1;
+  int BitsAllocated = 16;
+  int PixelRepresentation = 0;
+  int InstanceNumber = 0;
+  bool HasPosition = false;
+  double Position[3] = {0.0, 0.0, 0.0};
+  double Orientation[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+  double PixelSpacing[2] = {1.0, 1.0};
+  std::uint64_t PixelDataOffset = 0;
+  std::uint64_t PixelDataLength = 0;
+};
+
+// Reads the elements of a DICOM file up to the pixel data, and stops there.
+// Handles the uncompressed little endian transfer syntaxes, where the pixels
+// can be read in place.
+class HeaderParser
+{
+public:
+  explicit HeaderParser(std::string const& fileName)
+    : File(fileName, std::ios::binary)
+  {
+  }
+
+  bool Parse(SliceHeader& header);
+
+private:
+  static constexpr std::uint32_t UndefinedLength = 0xFFFFFFFF;
+
+  bool Ensure(std::size_t size);
+  bool Skip(std::uint32_t length);
+  bool ReadElementHeader(bool explicitVR, std::uint16_t& group,
+                         std::uint16_t& element, std::uint32_t& length);
+  bool SkipSequence(bool explicitVR);
+  bool SkipItem(bool explicitVR);
+  std::uint16_t UInt16(std::size_t at) const;
+  std::uint32_t UInt32(std::size_t at) const;
+  std::vector<double> Numbers(std::uint32_t length) const;
+
+  std::ifstream File;
+  std::vector<char> Buffer;
+  std::size_t Position = 0;
+};
+
+// The headers of the DICOM files of a folder, sorted along the slice normal
+std::vector<SliceHeader> ScanSeries(std::string const& folder);
+
+// Allocates the volume of a series, with the geometry of its first slice
+void AllocateVolume(std::vector<SliceHeader> const& headers,
+                    vtkImageData* volume);
+
+// Reads every slice into the preallocated volume, a slice per task of
+// vtkSMPTools. Returns the number of slices that could not be read.
+int ReadSlices(std::vector<SliceHeader> const& headers, vtkImageData* volume);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Verify input arguments.
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " FolderName [repeats]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  int repeats = 3;
+  if (argc > 2)
+  {
+    repeats = std::max(1, std::atoi(argv[2]));
+  }
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  auto headers = ScanSeries(argv[1]);
+  timer->StopTimer();
+  if (headers.empty())
+  {
+    std::cout << "No DICOM images in " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+  double scanTime = timer->GetElapsedTime();
+
+  // The best of a few reads, once the files are in the file system cache.
+  vtkNew<vtkDICOMImageReader> reader;
+  reader->SetDirectoryName(argv[1]);
+  double readerTime = VTK_DOUBLE_MAX;
+  for (int i = 0; i < repeats; ++i)
+  {
+    reader->Modified();
+    timer->StartTimer();
+    reader->Update();
+    timer->StopTimer();
+    readerTime = std::min(readerTime, timer->GetElapsedTime());
+  }
+  auto expected = reader->GetOutput()->GetPointData()->GetScalars();
+
+  auto numberOfSlices = static_cast<double>(headers.size());
+  double megabytes =
+      expected->GetNumberOfValues() * expected->GetDataTypeSize() / 1.0e6;
+  int maxThreads = vtkSMPTools::GetEstimatedNumberOfThreads();
+  std::cout << headers.size() << " slices of " << headers.front().Columns
+            << " x " << headers.front().Rows << ", " << megabytes
+            << " MB, headers scanned in " << scanTime << " s" << std::endl;
+  std::cout << vtkSMPTools::GetBackend() << " backend, up to " << maxThreads
+            << " threads" << std::endl;
+  std::cout << "reader,threads,seconds,slices_per_s,MB_per_s,speedup"
+            << std::endl;
+  std::cout << "vtkDICOMImageReader,1," << readerTime << ","
+            << numberOfSlices / readerTime << "," << megabytes / readerTime
+            << ",1" << std::endl;
+
+  vtkNew<vtkImageData> volume;
+  AllocateVolume(headers, volume);
+  int failures = 0;
+  for (int threads = 1;; threads = std::min(2 * threads, maxThreads))
+  {
+    vtkSMPTools::Initialize(threads);
+    double parallelTime = VTK_DOUBLE_MAX;
+    for (int i = 0; i < repeats; ++i)
+    {
+      timer->StartTimer();
+      failures = ReadSlices(headers, volume);
+      timer->StopTimer();
+      parallelTime = std::min(parallelTime, timer->GetElapsedTime());
+    }
+    std::cout << "parallel," << threads << "," << parallelTime << ","
+              << numberOfSlices / parallelTime << ","
+              << megabytes / parallelTime << "," << readerTime / parallelTime
+              << std::endl;
+    if (threads == maxThreads)
+    {
+      break;
+    }
+  }
+  if (failures > 0)
+  {
+    std::cout << failures << " slices could not be read" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Same voxels as vtkDICOMImageReader
+  auto scalars = volume->GetPointData()->GetScalars();
+  vtkIdType mismatches = 0;
+  if (scalars->GetNumberOfValues() != expected->GetNumberOfValues())
+  {
+    mismatches = scalars->GetNumberOfValues();
+  }
+  else
+  {
+    int numberOfComponents = scalars->GetNumberOfComponents();
+    for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); ++i)
+    {
+      for (int j = 0; j < numberOfComponents; ++j)
+      {
+        if (scalars->GetComponent(i, j) != expected->GetComponent(i, j))
+        {
+          ++mismatches;
+        }
+      }
+    }
+  }
+  std::cout << mismatches << " voxels differ from vtkDICOMImageReader"
+            << std::endl;
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace {
+bool HeaderParser::Ensure(std::size_t size)
+{
+  while (this->Buffer.size() < this->Position + size)
+  {
+    std::size_t chunk =
+        std::max<std::size_t>(16384, this->Position + size - this->Buffer.size());
+    std::size_t end = this->Buffer.size();
+    this->Buffer.resize(end + chunk);
+    this->File.read(this->Buffer.data() + end, chunk);
+    this->Buffer.resize(end + static_cast<std::size_t>(this->File.gcount()));
+    if (this->File.gcount() == 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HeaderParser::Skip(std::uint32_t length)
+{
+  if (!this->Ensure(length))
+  {
+    return false;
+  }
+  this->Position += length;
+  return true;
+}
+
+std::uint16_t HeaderParser::UInt16(std::size_t at) const
+{
+  auto bytes = reinterpret_cast<const unsigned char*>(this->Buffer.data() + at);
+  return static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+std::uint32_t HeaderParser::UInt32(std::size_t at) const
+{
+  return this->UInt16(at) | (static_cast<std::uint32_t>(this->UInt16(at + 2)) << 16);
+}
+
+// The backslash separated numbers of a DS or IS value at Position
+std::vector<double> HeaderParser::Numbers(std::uint32_t length) const
+{
+  std::string text(this->Buffer.data() + this->Position, length);
+  std::replace(text.begin(), text.end(), '\\', ' ');
+  std::istringstream stream(text);
+  std::vector<double> numbers;
+  double value;
+  while (stream >> value)
+  {
+    numbers.push_back(value);
+  }
+  return numbers;
+}
+
+bool HeaderParser::ReadElementHeader(bool explicitVR, std::uint16_t& group,
+                                     std::uint16_t& element,
+                                     std::uint32_t& length)
+{
+  if (!this->Ensure(8))
+  {
+    return false;
+  }
+  group = this->UInt16(this->Position);
+  element = this->UInt16(this->Position + 2);
+  // Items and delimiters have no VR, whatever the transfer syntax
+  if (!explicitVR || group == 0xFFFE)
+  {
+    length = this->UInt32(this->Position + 4);
+    this->Position += 8;
+    return true;
+  }
+  std::string vr(this->Buffer.data() + this->Position + 4, 2);
+  static const char* longVRs[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ",
+                                  "SV", "UC", "UN", "UR", "UT", "UV"};
+  if (std::find(std::begin(longVRs), std::end(longVRs), vr) !=
+      std::end(longVRs))
+  {
+    if (!this->Ensure(12))
+    {
+      return false;
+    }
+    length = this->UInt32(this->Position + 8);
+    this->Position += 12;
+  }
+  else
+  {
+    length = this->UInt16(this->Position + 6);
+    this->Position += 8;
+  }
+  return true;
+}
+
+// Skips the items of a sequence of undefined length, up to its delimiter
+bool HeaderParser::SkipSequence(bool explicitVR)
+{
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->ReadElementHeader(explicitVR, group, element, length))
+  {
+    if (group == 0xFFFE && element == 0xE0DD)
+    {
+      return true;
+    }
+    if (group != 0xFFFE || element != 0xE000)
+    {
+      return false;
+    }
+    if (!(length == UndefinedLength ? this->SkipItem(explicitVR)
+                                    : this->Skip(length)))
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Skips the elements of an item of undefined length, up to its delimiter
+bool HeaderParser::SkipItem(bool explicitVR)
+{
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->ReadElementHeader(explicitVR, group, element, length))
+  {
+    if (group == 0xFFFE && element == 0xE00D)
+    {
+      return true;
+    }
+    if (!(length == UndefinedLength ? this->SkipSequence(explicitVR)
+                                    : this->Skip(length)))
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool HeaderParser::Parse(SliceHeader& header)
+{
+  if (!this->File || !this->Ensure(6))
+  {
+    return false;
+  }
+  // Part 10 files have a 128 byte preamble, and a meta information group
+  // always in explicit VR. Older files start with the data set.
+  bool inMeta = false;
+  bool explicitVR;
+  if (this->Ensure(132) && std::memcmp(this->Buffer.data() + 128, "DICM", 4) == 0)
+  {
+    this->Position = 132;
+    inMeta = true;
+    explicitVR = true;
+  }
+  else
+  {
+    this->Position = 0;
+    explicitVR = std::isupper(static_cast<unsigned char>(this->Buffer[4])) &&
+        std::isupper(static_cast<unsigned char>(this->Buffer[5]));
+  }
+
+  std::string transferSyntax;
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->Ensure(2))
+  {
+    if (inMeta && this->UInt16(this->Position) != 0x0002)
+    {
+      inMeta = false;
+      if (transferSyntax == "1.2.840.10008.1.2")
+      {
+        explicitVR = false;
+      }
+      else if (transferSyntax != "1.2.840.10008.1.2.1")
+      {
+        std::cout << header.FileName << ": transfer syntax " << transferSyntax
+                  << " is not supported" << std::endl;
+        return false;
+      }
+    }
+    if (!this->ReadElementHeader(explicitVR, group, element, length))
+    {
+      return false;
+    }
+    std::uint32_t tag = (static_cast<std::uint32_t>(group) << 16) | element;
+    if (tag == 0x7FE00010)
+    {
+      // Uncompressed pixels have a defined length, they start right here.
+      header.PixelDataOffset = this->Position;
+      header.PixelDataLength = length;
+      return length != UndefinedLength && header.Rows > 0 && header.Columns > 0;
+    }
+    if (length == UndefinedLength)
+    {
+      if (!this->SkipSequence(explicitVR))
+      {
+        return false;
+      }
+      continue;
+    }
+    if (!this->Ensure(length))
+    {
+      return false;
+    }
+    std::vector<double> numbers;
+    switch (tag)
+    {
+      case 0x00020010:
+        transferSyntax.assign(this->Buffer.data() + this->Position, length);
+        transferSyntax.erase(transferSyntax.find_last_not_of(std::string(" \0", 2)) + 1);
+        break;
+      case 0x00200013:
+        numbers = this->Numbers(length);
+        header.InstanceNumber = numbers.empty() ? 0 : static_cast<int>(numbers[0]);
+        break;
+      case 0x00200032:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 3)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.Position);
+          header.HasPosition = true;
+        }
+        break;
+      case 0x00200037:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 6)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.Orientation);
+        }
+        break;
+      case 0x00280002:
+        header.SamplesPerPixel = this->UInt16(this->Position);
+        break;
+      case 0x00280010:
+        header.Rows = this->UInt16(this->Position);
+        break;
+      case 0x00280011:
+        header.Columns = this->UInt16(this->Position);
+        break;
+      case 0x00280030:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 2)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.PixelSpacing);
+        }
+        break;
+      case 0x00280100:
+        header.BitsAllocated = this->UInt16(this->Position);
+        break;
+      case 0x00280103:
+        header.PixelRepresentation = this->UInt16(this->Position);
+        break;
+      default:
+        break;
+    }
+    this->Position += length;
+  }
+  return false;
+}
+
+std::vector<SliceHeader> ScanSeries(std::string const& folder)
+{
+  std::vector<SliceHeader> headers;
+  vtkNew<vtkDirectory> directory;
+  if (!directory->Open(folder.c_str()))
+  {
+    return headers;
+  }
+  for (vtkIdType i = 0; i < directory->GetNumberOfFiles(); ++i)
+  {
+    std::string name = directory->GetFile(i);
+    std::string path = folder + "/" + name;
+    if (name[0] == '.' || directory->FileIsDirectory(name.c_str()))
+    {
+      continue;
+    }
+    SliceHeader header;
+    header.FileName = path;
+    if (HeaderParser(path).Parse(header))
+    {
+      headers.push_back(header);
+    }
+  }
+  if (headers.empty())
+  {
+    return headers;
+  }
+
+  // One series: the slices stored like the first one
+  auto const& first = headers.front();
+  auto const columns = first.Columns;
+  auto const rows = first.Rows;
+  auto const bits = first.BitsAllocated;
+  auto const samples = first.SamplesPerPixel;
+  headers.erase(std::remove_if(headers.begin(), headers.end(),
+                               [&](SliceHeader const& header) {
+                                 return header.Columns != columns ||
+                                     header.Rows != rows ||
+                                     header.BitsAllocated != bits ||
+                                     header.SamplesPerPixel != samples;
+                               }),
+                headers.end());
+
+  // Along the normal of the slices when they have a position, else by
+  // instance number
+  double normal[3];
+  vtkMath::Cross(headers.front().Orientation, headers.front().Orientation + 3,
+                 normal);
+  std::stable_sort(headers.begin(), headers.end(),
+                   [&](SliceHeader const& a, SliceHeader const& b) {
+                     if (a.HasPosition && b.HasPosition)
+                     {
+                       return vtkMath::Dot(a.Position, normal) <
+                           vtkMath::Dot(b.Position, normal);
+                     }
+                     return a.InstanceNumber < b.InstanceNumber;
+                   });
+  return headers;
+}
+
+void AllocateVolume(std::vector<SliceHeader> const& headers,
+                    vtkImageData* volume)
+{
+  auto const& first = headers.front();
+  double sliceSpacing = 1.0;
+  if (headers.size() > 1 && first.HasPosition)
+  {
+    double distance = std::sqrt(vtkMath::Distance2BetweenPoints(
+        first.Position, headers[1].Position));
+    if (distance > 0.0)
+    {
+      sliceSpacing = distance;
+    }
+  }
+  int scalarType = VTK_UNSIGNED_CHAR;
+  if (first.BitsAllocated == 16)
+  {
+    scalarType = first.PixelRepresentation ? VTK_SHORT : VTK_UNSIGNED_SHORT;
+  }
+  volume->SetDimensions(first.Columns, first.Rows,
+                        static_cast<int>(headers.size()));
+  volume->SetSpacing(first.PixelSpacing[1], first.PixelSpacing[0],
+                     sliceSpacing);
+  volume->SetOrigin(first.Position);
+  volume->AllocateScalars(scalarType, first.SamplesPerPixel);
+}
+
+int ReadSlices(std::vector<SliceHeader> const& headers, vtkImageData* volume)
+{
+  auto const& first = headers.front();
+  auto scalars = volume->GetPointData()->GetScalars();
+  auto base = static_cast<char*>(scalars->GetVoidPointer(0));
+  std::size_t rowSize = static_cast<std::size_t>(first.Columns) *
+      first.SamplesPerPixel * scalars->GetDataTypeSize();
+  std::size_t sliceSize = rowSize * first.Rows;
+
+  std::vector<char> failed(headers.size(), 0);
+  // A slice is a task: the threads take the next one as they are done.
+  vtkSMPTools::For(
+      0, static_cast<vtkIdType>(headers.size()), 1,
+      [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType k = begin; k < end; ++k)
+        {
+          auto const& header = headers[k];
+          char* slice = base + k * sliceSize;
+          std::ifstream file(header.FileName, std::ios::binary);
+          file.seekg(static_cast<std::streamoff>(header.PixelDataOffset));
+          if (header.PixelDataLength < sliceSize ||
+              !file.read(slice, static_cast<std::streamsize>(sliceSize)))
+          {
+            failed[k] = 1;
+            continue;
+          }
+          // DICOM stores the top row first, VTK the bottom row.
+          for (int row = 0; row < first.Rows / 2; ++row)
+          {
+            std::swap_ranges(slice + row * rowSize, slice + (row + 1) * rowSize,
+                             slice + (first.Rows - 1 - row) * rowSize);
+          }
+          if (first.BitsAllocated == 16)
+          {
+            vtkByteSwap::SwapLERange(reinterpret_cast<unsigned short*>(slice),
+                                     sliceSize / 2);
+          }
+        }
+      });
+  scalars->Modified();
+  return static_cast<int>(std::count(failed.begin(), failed.end(), 1));
+}
+} // namespace
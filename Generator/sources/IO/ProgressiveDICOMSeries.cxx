@@ -0,0 +1,873 @@
+//
+// This example shows a series of DICOM images before it is read. It scans
+// the headers of the files, shows the empty volume, and decodes the slices
+// in background threads (or on the main thread, one per timer tick, without
+// threads), the slices closest to the one viewed first.
+// Scroll with the mousewheel or the up/down keys through the slices.
+//
+#include <vtkActor2D.h>
+#include <vtkCommand.h>
+#include <vtkDICOMImageReader.h>
+#include <vtkDataArray.h>
+#include <vtkDirectory.h>
+#include <vtkImageData.h>
+#include <vtkImageViewer2.h>
+#include <vtkInteractorStyleImage.h>
+#include <vtkMath.h>
+#include <vtkNamedColors.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkTextMapper.h>
+#include <vtkTextProperty.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+// What the viewer needs to know of a slice before its pixels are decoded
+struct SliceHeader
+{
+  std::string FileName;
+  int Columns = 0;
+  int Rows = 0;
+  int SamplesPerPixel = 1;
+  int BitsAllocated = 16;
+  int PixelRepresentation = 0;
+  int InstanceNumber = 0;
+  bool HasPosition = false;
+  double Position[3] = {0.0, 0.0, 0.0};
+  double Orientation[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+  double PixelSpacing[2] = {1.0, 1.0};
+  double SliceThickness = 0.0;
+  double WindowCenter = 0.0;
+  double WindowWidth = 0.0;
+};
+
+// Reads the elements of a DICOM file up to the image pixel module, and stops
+// there: the pixel data are never read. Handles the uncompressed little
+// endian transfer syntaxes, the ones vtkDICOMImageReader decodes.
+class HeaderParser
+{
+public:
+  explicit HeaderParser(std::string const& fileName)
+    : File(fileName, std::ios::binary)
+  {
+  }
+
+  bool Parse(SliceHeader& header);
+
+private:
+  static constexpr std::uint32_t UndefinedLength = 0xFFFFFFFF;
+
+  bool Ensure(std::size_t size);
+  bool Skip(std::uint32_t length);
+  bool ReadElementHeader(bool explicitVR, std::uint16_t& group,
+                         std::uint16_t& element, std::uint32_t& length);
+  bool SkipSequence(bool explicitVR);
+  bool SkipItem(bool explicitVR);
+  std::uint16_t UInt16(std::size_t at) const;
+  std::uint32_t UInt32(std::size_t at) const;
+  std::vector<double> Numbers(std::uint32_t length) const;
+
+  std::ifstream File;
+  std::vector<char> Buffer;
+  std::size_t Position = 0;
+};
+
+// The headers of the DICOM files of a folder, sorted along the slice normal
+std::vector<SliceHeader> ScanSeries(std::string const& folder);
+
+// Decodes the slices of a series in background threads. Each thread claims
+// the slice closest to the focus that nobody claimed yet. With no threads
+// (numberOfThreads is 0, or a WASM build without pthreads), DecodeNext
+// decodes the next slice on the calling thread instead.
+class SliceDecoder
+{
+public:
+  SliceDecoder(std::vector<std::string> fileNames, int numberOfThreads);
+  ~SliceDecoder();
+  SliceDecoder(const SliceDecoder&) = delete;
+  SliceDecoder& operator=(const SliceDecoder&) = delete;
+
+  void SetFocus(int slice)
+  {
+    this->Focus = slice;
+  }
+
+  bool HasThreads() const
+  {
+    return !this->Threads.empty();
+  }
+
+  // Claims and decodes the next slice on the calling thread, false when all
+  // the slices are claimed
+  bool DecodeNext();
+
+  // The slices decoded since the last call. The scalars are null when the
+  // file could not be read.
+  std::vector<std::pair<int, vtkSmartPointer<vtkDataArray>>> TakeDecoded();
+
+private:
+  void Run();
+  int ClaimNext();
+  void Decode(int slice);
+
+  std::vector<std::string> FileNames;
+  std::vector<bool> Claimed;
+  std::vector<std::pair<int, vtkSmartPointer<vtkDataArray>>> Decoded;
+  std::mutex Mutex;
+  std::atomic<int> Focus{0};
+  std::atomic<bool> Stop{false};
+  std::vector<std::thread> Threads;
+};
+
+// The volume being filled, and the viewer showing it
+struct SeriesView
+{
+  vtkImageViewer2* Viewer = nullptr;
+  vtkImageData* Volume = nullptr;
+  vtkTextMapper* StatusMapper = nullptr;
+  SliceDecoder* Decoder = nullptr;
+  std::vector<bool> Ready;
+  int NumberOfReady = 0;
+
+  void ShowSlice(int slice);
+  void UpdateStatus();
+};
+
+// Moves the decoded slices into the volume, on the thread that renders.
+// Without decoding threads, decodes a slice first.
+class DecodedSlicesCallback : public vtkCommand
+{
+public:
+  static DecodedSlicesCallback* New();
+  vtkTypeMacro(DecodedSlicesCallback, vtkCommand);
+
+  void Execute(vtkObject* caller, unsigned long eventId,
+               void* callData) override;
+
+  SeriesView* View = nullptr;
+  vtkTimerLog* Clock = nullptr;
+  bool HasWindowLevel = false;
+  int TimerId = -1;
+
+private:
+  bool FirstImageShown = false;
+  int NumberOfTaken = 0;
+};
+
+// Scrolls through the slices, and moves the focus of the decoder along
+class ProgressiveSliceStyle : public vtkInteractorStyleImage
+{
+public:
+  static ProgressiveSliceStyle* New();
+  vtkTypeMacro(ProgressiveSliceStyle, vtkInteractorStyleImage);
+
+  void OnKeyDown() override;
+  void OnMouseWheelForward() override;
+  void OnMouseWheelBackward() override;
+
+  SeriesView* View = nullptr;
+
+private:
+  void MoveSlice(int step);
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  vtkNew<vtkNamedColors> colors;
+
+  // Verify input arguments.
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0]
+              << " FolderName [decoding threads, 0 for none]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  int numberOfThreads = 2;
+  if (argc > 2)
+  {
+    numberOfThreads = std::max(0, std::atoi(argv[2]));
+  }
+
+  vtkNew<vtkTimerLog> clock;
+  clock->StartTimer();
+
+  // Only the headers: the size of the volume, and the order of the slices.
+  auto headers = ScanSeries(argv[1]);
+  if (headers.empty())
+  {
+    std::cout << "No DICOM images in " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+  }
+  clock->StopTimer();
+  std::cout << "Scanned the headers of " << headers.size() << " slices in "
+            << clock->GetElapsedTime() << " s" << std::endl;
+
+  auto const& first = headers.front();
+  double sliceSpacing = first.SliceThickness > 0.0 ? first.SliceThickness : 1.0;
+  if (headers.size() > 1 && first.HasPosition)
+  {
+    double distance = std::sqrt(vtkMath::Distance2BetweenPoints(
+        first.Position, headers[1].Position));
+    if (distance > 0.0)
+    {
+      sliceSpacing = distance;
+    }
+  }
+
+  // Publish the whole extent at once, the slices are filled as they come.
+  int scalarType = VTK_UNSIGNED_CHAR;
+  if (first.BitsAllocated == 16)
+  {
+    scalarType = first.PixelRepresentation ? VTK_SHORT : VTK_UNSIGNED_SHORT;
+  }
+  vtkNew<vtkImageData> volume;
+  volume->SetDimensions(first.Columns, first.Rows,
+                        static_cast<int>(headers.size()));
+  volume->SetSpacing(first.PixelSpacing[1], first.PixelSpacing[0],
+                     sliceSpacing);
+  volume->SetOrigin(first.Position);
+  volume->AllocateScalars(scalarType, first.SamplesPerPixel);
+  volume->GetPointData()->GetScalars()->Fill(0);
+
+  std::vector<std::string> fileNames;
+  for (auto const& header : headers)
+  {
+    fileNames.push_back(header.FileName);
+  }
+  SliceDecoder decoder(fileNames, numberOfThreads);
+
+  vtkNew<vtkImageViewer2> imageViewer;
+  imageViewer->SetInputData(volume);
+
+  SeriesView view;
+  view.Viewer = imageViewer;
+  view.Volume = volume;
+  view.Decoder = &decoder;
+  view.Ready.assign(headers.size(), false);
+
+  // Slice status message.
+  vtkNew<vtkTextProperty> sliceTextProp;
+  sliceTextProp->SetFontFamilyToCourier();
+  sliceTextProp->SetFontSize(20);
+  sliceTextProp->SetVerticalJustificationToBottom();
+  sliceTextProp->SetJustificationToLeft();
+
+  vtkNew<vtkTextMapper> sliceTextMapper;
+  sliceTextMapper->SetTextProperty(sliceTextProp);
+  view.StatusMapper = sliceTextMapper;
+  view.UpdateStatus();
+
+  vtkNew<vtkActor2D> sliceTextActor;
+  sliceTextActor->SetMapper(sliceTextMapper);
+  sliceTextActor->SetPosition(15, 10);
+
+  vtkNew<vtkRenderWindowInteractor> renderWindowInteractor;
+  vtkNew<ProgressiveSliceStyle> style;
+  style->View = &view;
+  imageViewer->SetupInteractor(renderWindowInteractor);
+  // SetupInteractor sets its own style, replace it afterwards.
+  renderWindowInteractor->SetInteractorStyle(style);
+  imageViewer->GetRenderer()->AddActor2D(sliceTextActor);
+  imageViewer->GetRenderer()->SetBackground(
+      colors->GetColor3d("SlateGray").GetData());
+  imageViewer->GetRenderWindow()->SetSize(800, 800);
+  imageViewer->GetRenderWindow()->SetWindowName("ProgressiveDICOMSeries");
+
+  vtkNew<DecodedSlicesCallback> callback;
+  callback->View = &view;
+  callback->Clock = clock;
+  if (first.WindowWidth > 0.0)
+  {
+    imageViewer->SetColorWindow(first.WindowWidth);
+    imageViewer->SetColorLevel(first.WindowCenter);
+    callback->HasWindowLevel = true;
+  }
+
+  // The empty volume is on screen before any slice is decoded.
+  imageViewer->Render();
+  imageViewer->GetRenderer()->ResetCamera();
+  imageViewer->Render();
+
+  renderWindowInteractor->Initialize();
+  renderWindowInteractor->AddObserver(vtkCommand::TimerEvent, callback);
+  callback->TimerId = renderWindowInteractor->CreateRepeatingTimer(20);
+  renderWindowInteractor->Start();
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+bool HeaderParser::Ensure(std::size_t size)
+{
+  while (this->Buffer.size() < this->Position + size)
+  {
+    std::size_t chunk =
+        std::max<std::size_t>(16384, this->Position + size - this->Buffer.size());
+    std::size_t end = this->Buffer.size();
+    this->Buffer.resize(end + chunk);
+    this->File.read(this->Buffer.data() + end, chunk);
+    this->Buffer.resize(end + static_cast<std::size_t>(this->File.gcount()));
+    if (this->File.gcount() == 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HeaderParser::Skip(std::uint32_t length)
+{
+  if (!this->Ensure(length))
+  {
+    return false;
+  }
+  this->Position += length;
+  return true;
+}
+
+std::uint16_t HeaderParser::UInt16(std::size_t at) const
+{
+  auto bytes = reinterpret_cast<const unsigned char*>(this->Buffer.data() + at);
+  return static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+std::uint32_t HeaderParser::UInt32(std::size_t at) const
+{
+  return this->UInt16(at) | (static_cast<std::uint32_t>(this->UInt16(at + 2)) << 16);
+}
+
+// The backslash separated numbers of a DS or IS value at Position
+std::vector<double> HeaderParser::Numbers(std::uint32_t length) const
+{
+  std::string text(this->Buffer.data() + this->Position, length);
+  std::replace(text.begin(), text.end(), '\\', ' ');
+  std::istringstream stream(text);
+  std::vector<double> numbers;
+  double value;
+  while (stream >> value)
+  {
+    numbers.push_back(value);
+  }
+  return numbers;
+}
+
+bool HeaderParser::ReadElementHeader(bool explicitVR, std::uint16_t& group,
+                                     std::uint16_t& element,
+                                     std::uint32_t& length)
+{
+  if (!this->Ensure(8))
+  {
+    return false;
+  }
+  group = this->UInt16(this->Position);
+  element = this->UInt16(this->Position + 2);
+  // Items and delimiters have no VR, whatever the transfer syntax
+  if (!explicitVR || group == 0xFFFE)
+  {
+    length = this->UInt32(this->Position + 4);
+    this->Position += 8;
+    return true;
+  }
+  std::string vr(this->Buffer.data() + this->Position + 4, 2);
+  static const char* longVRs[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ",
+                                  "SV", "UC", "UN", "UR", "UT", "UV"};
+  if (std::find(std::begin(longVRs), std::end(longVRs), vr) !=
+      std::end(longVRs))
+  {
+    if (!this->Ensure(12))
+    {
+      return false;
+    }
+    length = this->UInt32(this->Position + 8);
+    this->Position += 12;
+  }
+  else
+  {
+    length = this->UInt16(this->Position + 6);
+    this->Position += 8;
+  }
+  return true;
+}
+
+// Skips the items of a sequence of undefined length, up to its delimiter
+bool HeaderParser::SkipSequence(bool explicitVR)
+{
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->ReadElementHeader(explicitVR, group, element, length))
+  {
+    if (group == 0xFFFE && element == 0xE0DD)
+    {
+      return true;
+    }
+    if (group != 0xFFFE || element != 0xE000)
+    {
+      return false;
+    }
+    if (!(length == UndefinedLength ? this->SkipItem(explicitVR)
+                                    : this->Skip(length)))
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+// Skips the elements of an item of undefined length, up to its delimiter
+bool HeaderParser::SkipItem(bool explicitVR)
+{
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->ReadElementHeader(explicitVR, group, element, length))
+  {
+    if (group == 0xFFFE && element == 0xE00D)
+    {
+      return true;
+    }
+    if (!(length == UndefinedLength ? this->SkipSequence(explicitVR)
+                                    : this->Skip(length)))
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+bool HeaderParser::Parse(SliceHeader& header)
+{
+  if (!this->File || !this->Ensure(6))
+  {
+    return false;
+  }
+  // Part 10 files have a 128 byte preamble, and a meta information group
+  // always in explicit VR. Older files start with the data set.
+  bool inMeta = false;
+  bool explicitVR;
+  if (this->Ensure(132) && std::memcmp(this->Buffer.data() + 128, "DICM", 4) == 0)
+  {
+    this->Position = 132;
+    inMeta = true;
+    explicitVR = true;
+  }
+  else
+  {
+    this->Position = 0;
+    explicitVR = std::isupper(static_cast<unsigned char>(this->Buffer[4])) &&
+        std::isupper(static_cast<unsigned char>(this->Buffer[5]));
+  }
+
+  std::string transferSyntax;
+  std::uint16_t group;
+  std::uint16_t element;
+  std::uint32_t length;
+  while (this->Ensure(2))
+  {
+    if (inMeta && this->UInt16(this->Position) != 0x0002)
+    {
+      inMeta = false;
+      if (transferSyntax == "1.2.840.10008.1.2")
+      {
+        explicitVR = false;
+      }
+      else if (transferSyntax != "1.2.840.10008.1.2.1")
+      {
+        std::cout << header.FileName << ": transfer syntax " << transferSyntax
+                  << " is not supported" << std::endl;
+        return false;
+      }
+    }
+    // The elements are sorted by tag, nothing past the image pixel module
+    // is needed.
+    if (this->UInt16(this->Position) > 0x0028)
+    {
+      break;
+    }
+    if (!this->ReadElementHeader(explicitVR, group, element, length))
+    {
+      return false;
+    }
+    if (length == UndefinedLength)
+    {
+      if (!this->SkipSequence(explicitVR))
+      {
+        return false;
+      }
+      continue;
+    }
+    if (!this->Ensure(length))
+    {
+      return false;
+    }
+    std::uint32_t tag = (static_cast<std::uint32_t>(group) << 16) | element;
+    std::vector<double> numbers;
+    switch (tag)
+    {
+      case 0x00020010:
+        transferSyntax.assign(this->Buffer.data() + this->Position, length);
+        transferSyntax.erase(transferSyntax.find_last_not_of(std::string(" \0", 2)) + 1);
+        break;
+      case 0x00180050:
+        numbers = this->Numbers(length);
+        header.SliceThickness = numbers.empty() ? 0.0 : numbers[0];
+        break;
+      case 0x00200013:
+        numbers = this->Numbers(length);
+        header.InstanceNumber = numbers.empty() ? 0 : static_cast<int>(numbers[0]);
+        break;
+      case 0x00200032:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 3)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.Position);
+          header.HasPosition = true;
+        }
+        break;
+      case 0x00200037:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 6)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.Orientation);
+        }
+        break;
+      case 0x00280002:
+        header.SamplesPerPixel = this->UInt16(this->Position);
+        break;
+      case 0x00280010:
+        header.Rows = this->UInt16(this->Position);
+        break;
+      case 0x00280011:
+        header.Columns = this->UInt16(this->Position);
+        break;
+      case 0x00280030:
+        numbers = this->Numbers(length);
+        if (numbers.size() == 2)
+        {
+          std::copy(numbers.begin(), numbers.end(), header.PixelSpacing);
+        }
+        break;
+      case 0x00280100:
+        header.BitsAllocated = this->UInt16(this->Position);
+        break;
+      case 0x00280103:
+        header.PixelRepresentation = this->UInt16(this->Position);
+        break;
+      case 0x00281050:
+        numbers = this->Numbers(length);
+        header.WindowCenter = numbers.empty() ? 0.0 : numbers[0];
+        break;
+      case 0x00281051:
+        numbers = this->Numbers(length);
+        header.WindowWidth = numbers.empty() ? 0.0 : numbers[0];
+        break;
+      default:
+        break;
+    }
+    this->Position += length;
+  }
+  return header.Rows > 0 && header.Columns > 0;
+}
+
+std::vector<SliceHeader> ScanSeries(std::string const& folder)
+{
+  std::vector<SliceHeader> headers;
+  vtkNew<vtkDirectory> directory;
+  if (!directory->Open(folder.c_str()))
+  {
+    return headers;
+  }
+  for (vtkIdType i = 0; i < directory->GetNumberOfFiles(); ++i)
+  {
+    std::string name = directory->GetFile(i);
+    std::string path = folder + "/" + name;
+    if (name[0] == '.' || directory->FileIsDirectory(name.c_str()))
+    {
+      continue;
+    }
+    SliceHeader header;
+    header.FileName = path;
+    if (HeaderParser(path).Parse(header))
+    {
+      headers.push_back(header);
+    }
+  }
+  if (headers.empty())
+  {
+    return headers;
+  }
+
+  // One series: the slices of the size of the first one
+  auto const columns = headers.front().Columns;
+  auto const rows = headers.front().Rows;
+  headers.erase(std::remove_if(headers.begin(), headers.end(),
+                               [&](SliceHeader const& header) {
+                                 return header.Columns != columns ||
+                                     header.Rows != rows;
+                               }),
+                headers.end());
+
+  // Along the normal of the slices when they have a position, else by
+  // instance number
+  double normal[3];
+  vtkMath::Cross(headers.front().Orientation, headers.front().Orientation + 3,
+                 normal);
+  std::stable_sort(headers.begin(), headers.end(),
+                   [&](SliceHeader const& a, SliceHeader const& b) {
+                     if (a.HasPosition && b.HasPosition)
+                     {
+                       return vtkMath::Dot(a.Position, normal) <
+                           vtkMath::Dot(b.Position, normal);
+                     }
+                     return a.InstanceNumber < b.InstanceNumber;
+                   });
+  return headers;
+}
+
+SliceDecoder::SliceDecoder(std::vector<std::string> fileNames,
+                           int numberOfThreads)
+  : FileNames(std::move(fileNames)), Claimed(this->FileNames.size(), false)
+{
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  // std::thread aborts without pthreads
+  numberOfThreads = 0;
+#endif
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    this->Threads.emplace_back(&SliceDecoder::Run, this);
+  }
+}
+
+SliceDecoder::~SliceDecoder()
+{
+  this->Stop = true;
+  for (auto& thread : this->Threads)
+  {
+    thread.join();
+  }
+}
+
+std::vector<std::pair<int, vtkSmartPointer<vtkDataArray>>>
+SliceDecoder::TakeDecoded()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  std::vector<std::pair<int, vtkSmartPointer<vtkDataArray>>> decoded;
+  decoded.swap(this->Decoded);
+  return decoded;
+}
+
+// The unclaimed slice closest to the focus, -1 when all are claimed.
+// Called with the mutex locked.
+int SliceDecoder::ClaimNext()
+{
+  auto numberOfSlices = static_cast<int>(this->FileNames.size());
+  int focus = std::min(std::max(0, this->Focus.load()), numberOfSlices - 1);
+  for (int distance = 0; distance < numberOfSlices; ++distance)
+  {
+    for (int slice : {focus + distance, focus - distance})
+    {
+      if (slice >= 0 && slice < numberOfSlices && !this->Claimed[slice])
+      {
+        this->Claimed[slice] = true;
+        return slice;
+      }
+    }
+  }
+  return -1;
+}
+
+void SliceDecoder::Run()
+{
+  while (!this->Stop)
+  {
+    int slice;
+    {
+      std::lock_guard<std::mutex> lock(this->Mutex);
+      slice = this->ClaimNext();
+    }
+    if (slice < 0)
+    {
+      return;
+    }
+    this->Decode(slice);
+  }
+}
+
+bool SliceDecoder::DecodeNext()
+{
+  int slice;
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    slice = this->ClaimNext();
+  }
+  if (slice < 0)
+  {
+    return false;
+  }
+  this->Decode(slice);
+  return true;
+}
+
+void SliceDecoder::Decode(int slice)
+{
+  // A reader per slice: each output array stays valid after the reader is
+  // gone.
+  vtkNew<vtkDICOMImageReader> reader;
+  reader->SetFileName(this->FileNames[slice].c_str());
+  reader->Update();
+  vtkSmartPointer<vtkDataArray> scalars =
+      reader->GetOutput()->GetPointData()->GetScalars();
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Decoded.emplace_back(slice, scalars);
+}
+
+void SeriesView::UpdateStatus()
+{
+  int slice = this->Viewer->GetSlice();
+  std::ostringstream message;
+  message << "Slice Number  " << slice + 1 << "/" << this->Ready.size();
+  if (!this->Ready[slice])
+  {
+    message << " (loading)";
+  }
+  if (this->NumberOfReady < static_cast<int>(this->Ready.size()))
+  {
+    message << "\nDecoded " << this->NumberOfReady << "/" << this->Ready.size();
+  }
+  this->StatusMapper->SetInput(message.str().c_str());
+}
+
+void SeriesView::ShowSlice(int slice)
+{
+  this->Viewer->SetSlice(slice);
+  this->Decoder->SetFocus(slice);
+  this->UpdateStatus();
+  this->Viewer->Render();
+}
+
+vtkStandardNewMacro(DecodedSlicesCallback);
+
+void DecodedSlicesCallback::Execute(vtkObject* caller, unsigned long,
+                                    void*)
+{
+  // Without threads, a slice per tick: the events are handled in between
+  if (!this->View->Decoder->HasThreads())
+  {
+    this->View->Decoder->DecodeNext();
+  }
+  auto decoded = this->View->Decoder->TakeDecoded();
+  if (decoded.empty())
+  {
+    return;
+  }
+  auto volume = this->View->Volume;
+  auto volumeScalars = volume->GetPointData()->GetScalars();
+  int* dimensions = volume->GetDimensions();
+  vtkIdType sliceSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1];
+  for (auto const& slice : decoded)
+  {
+    auto scalars = slice.second;
+    if (!scalars || scalars->GetNumberOfTuples() != sliceSize ||
+        scalars->GetNumberOfComponents() != volumeScalars->GetNumberOfComponents())
+    {
+      std::cout << "Could not decode slice " << slice.first << std::endl;
+      continue;
+    }
+    volumeScalars->InsertTuples(slice.first * sliceSize, sliceSize, 0, scalars);
+    if (!this->HasWindowLevel)
+    {
+      double range[2];
+      scalars->GetRange(range);
+      this->View->Viewer->SetColorWindow(std::max(1.0, range[1] - range[0]));
+      this->View->Viewer->SetColorLevel(0.5 * (range[0] + range[1]));
+      this->HasWindowLevel = true;
+    }
+    this->View->Ready[slice.first] = true;
+    ++this->View->NumberOfReady;
+  }
+  volumeScalars->Modified();
+  this->View->UpdateStatus();
+  this->View->Viewer->Render();
+
+  if (!this->FirstImageShown && this->View->Ready[this->View->Viewer->GetSlice()])
+  {
+    this->FirstImageShown = true;
+    this->Clock->StopTimer();
+    std::cout << "First image after " << this->Clock->GetElapsedTime() << " s"
+              << std::endl;
+  }
+  if (this->View->NumberOfReady == static_cast<int>(this->View->Ready.size()))
+  {
+    this->Clock->StopTimer();
+    std::cout << "All slices after " << this->Clock->GetElapsedTime() << " s"
+              << std::endl;
+  }
+  this->NumberOfTaken += static_cast<int>(decoded.size());
+  if (this->NumberOfTaken == static_cast<int>(this->View->Ready.size()))
+  {
+    auto interactor = dynamic_cast<vtkRenderWindowInteractor*>(caller);
+    interactor->DestroyTimer(this->TimerId);
+  }
+}
+
+vtkStandardNewMacro(ProgressiveSliceStyle);
+
+void ProgressiveSliceStyle::MoveSlice(int step)
+{
+  int slice = this->View->Viewer->GetSlice() + step;
+  if (slice >= this->View->Viewer->GetSliceMin() &&
+      slice <= this->View->Viewer->GetSliceMax())
+  {
+    this->View->ShowSlice(slice);
+  }
+}
+
+void ProgressiveSliceStyle::OnKeyDown()
+{
+  std::string key = this->GetInteractor()->GetKeySym();
+  if (key == "Up")
+  {
+    this->MoveSlice(1);
+  }
+  else if (key == "Down")
+  {
+    this->MoveSlice(-1);
+  }
+  // Forward the event.
+  vtkInteractorStyleImage::OnKeyDown();
+}
+
+// The mouse wheel events are not forwarded, they would zoom the image.
+void ProgressiveSliceStyle::OnMouseWheelForward()
+{
+  this->MoveSlice(1);
+}
+
+void ProgressiveSliceStyle::OnMouseWheelBackward()
+{
+  this->MoveSlice(-1);
+}
+} // namespace
@@ -1,5 +1,7 @@
 #include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
 #include <vtkCommand.h>
+#include <vtkDataArraySelection.h>
 #include <vtkDiscretizableColorTransferFunction.h>
 #include <vtkHDFReader.h>
 #include <vtkInteractorStyleTrackballCamera.h>
@@ -15,9 +17,42 @@
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
 
+#include <chrono>
 #include <cstdlib>
+#include <future>
+#include <iostream>
+
+// std::async needs a thread, WASM builds have threads only with pthreads
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define PREFETCH_ON_THREAD
+#endif
 
 namespace {
+// Reads the steps on a background thread, one step ahead of the one
+// rendered. Only that thread uses the reader once the playback starts.
+// Without threads, Advance reads the next step on the main thread.
+struct TransientPlayer
+{
+  vtkHDFReader* Reader = nullptr;
+  vtkPolyData* Displayed = nullptr;
+  std::future<void> NextStep;
+  // The step set on the reader and not read yet, without threads
+  bool Pending = false;
+  vtkIdType Step = 0;
+  vtkIdType StalledFrames = 0;
+
+  ~TransientPlayer();
+
+  // Starts reading the step after the one displayed
+  void Prefetch();
+
+  // Shows the step read, if it is, and prefetches the next one
+  bool Advance();
+};
+
+// Whether a and b share their points and cells
+bool SharesGeometry(vtkPolyData* a, vtkPolyData* b);
+
 vtkNew<vtkDiscretizableColorTransferFunction> GetCTF();
 
 void Animate(vtkObject* caller, unsigned long /*eid*/, void* clientdata,
@@ -36,12 +71,27 @@ int main(int ac, char* av[])
 
   vtkNew<vtkNamedColors> colors;
 
-  // Read the dataset.
+  // Read the dataset, only the array that is rendered. The cache keeps the
+  // points and cells of the steps that share them in the file, a static
+  // mesh, so they are read once.
   vtkNew<vtkHDFReader> reader;
   reader->SetFileName(av[1]);
+  reader->UseCacheOn();
+  reader->UpdateInformation();
+  reader->GetPointDataArraySelection()->DisableAllArrays();
+  reader->GetPointDataArraySelection()->EnableArray("SpatioTemporalHarmonics");
+  reader->GetCellDataArraySelection()->DisableAllArrays();
   reader->Update();
   std::cout << "Number of steps: " << reader->GetNumberOfSteps() << endl;
-  auto polydata = vtkPolyData::SafeDownCast(reader->GetOutput());
+
+  // The mapper renders a copy of the output, so the reader can read the next
+  // step while this one renders.
+  vtkNew<vtkPolyData> polydata;
+  polydata->ShallowCopy(vtkPolyData::SafeDownCast(reader->GetOutput()));
+  TransientPlayer player;
+  player.Reader = reader;
+  player.Displayed = polydata;
+  player.Prefetch();
 
   // Render the dataset.
   vtkNew<vtkPolyDataMapper> mapper;
@@ -71,23 +121,114 @@ int main(int ac, char* av[])
   // Add the animation callback.
   vtkNew<vtkCallbackCommand> command;
   command->SetCallback(Animate);
-  command->SetClientData(reader);
+  command->SetClientData(&player);
 
   // You must initialize the vtkRenderWindowInteractor
   // before adding the observer and setting the repeating timer.
+  // A timer of 16 ms plays the steps at 60 frames per second.
   iren->Initialize();
   iren->AddObserver(vtkCommand::TimerEvent, command);
-  iren->CreateRepeatingTimer(50);
+  iren->CreateRepeatingTimer(16);
 
   vtkNew<vtkInteractorStyleTrackballCamera> istyle;
   iren->SetInteractorStyle(istyle);
 
   iren->Start();
+  std::cout << "Frames waiting for a step: " << player.StalledFrames
+            << std::endl;
 
   return EXIT_SUCCESS;
 }
 
 namespace {
+TransientPlayer::~TransientPlayer()
+{
+  if (this->NextStep.valid())
+  {
+    this->NextStep.wait();
+  }
+}
+
+void TransientPlayer::Prefetch()
+{
+  if (this->Reader->GetNumberOfSteps() < 2)
+  {
+    return;
+  }
+  vtkIdType next =
+      (this->Step == this->Reader->GetNumberOfSteps() - 1) ? 0 : this->Step + 1;
+  this->Reader->SetStep(next);
+#ifdef PREFETCH_ON_THREAD
+  this->NextStep = std::async(std::launch::async,
+                              [reader = this->Reader]() { reader->Update(); });
+#else
+  this->Pending = true;
+#endif
+}
+
+bool TransientPlayer::Advance()
+{
+#ifdef PREFETCH_ON_THREAD
+  if (!this->NextStep.valid())
+  {
+    return false;
+  }
+  if (this->NextStep.wait_for(std::chrono::seconds(0)) !=
+      std::future_status::ready)
+  {
+    ++this->StalledFrames;
+    return false;
+  }
+  this->NextStep.get();
+#else
+  // The frame waits for the step
+  if (!this->Pending)
+  {
+    return false;
+  }
+  this->Reader->Update();
+  this->Pending = false;
+#endif
+  this->Step = this->Reader->GetStep();
+
+  // The points and cells the cache shares with the displayed step stay, so
+  // the mapper can keep their buffers.
+  auto output = vtkPolyData::SafeDownCast(this->Reader->GetOutput());
+  if (SharesGeometry(output, this->Displayed))
+  {
+    this->Displayed->GetPointData()->ShallowCopy(output->GetPointData());
+    this->Displayed->GetCellData()->ShallowCopy(output->GetCellData());
+  }
+  else
+  {
+    this->Displayed->ShallowCopy(output);
+  }
+  this->Prefetch();
+  return true;
+}
+
+bool SharesGeometry(vtkPolyData* a, vtkPolyData* b)
+{
+  if (!a->GetPoints() || !b->GetPoints() ||
+      a->GetPoints()->GetData() != b->GetPoints()->GetData())
+  {
+    return false;
+  }
+  vtkCellArray* cellsA[] = {a->GetVerts(), a->GetLines(), a->GetPolys(),
+                            a->GetStrips()};
+  vtkCellArray* cellsB[] = {b->GetVerts(), b->GetLines(), b->GetPolys(),
+                            b->GetStrips()};
+  for (int i = 0; i < 4; ++i)
+  {
+    if (cellsA[i]->GetOffsetsArray() != cellsB[i]->GetOffsetsArray() ||
+        cellsA[i]->GetConnectivityArray() != cellsB[i]->GetConnectivityArray())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 vtkNew<vtkDiscretizableColorTransferFunction> GetCTF()
 {
   vtkNew<vtkDiscretizableColorTransferFunction> ctf;
@@ -153,13 +294,14 @@ void Animate(vtkObject* caller, unsigned long /*eid*/, void* clientdata,
 {
   vtkRenderWindowInteractor* interactor =
       vtkRenderWindowInteractor::SafeDownCast(caller);
-  vtkHDFReader* reader =
-      vtkHDFReader::SafeDownCast(static_cast<vtkObjectBase*>(clientdata));
-  reader->SetStep((reader->GetStep() == reader->GetNumberOfSteps() - 1)
-                      ? 0
-                      : reader->GetStep() + 1);
-  std::cout << "Current step: " << reader->GetStep() << std::endl;
-  reader->Update();
+  auto player = static_cast<TransientPlayer*>(clientdata);
+
+  // Skip the frame rather than wait for the step
+  if (!player->Advance())
+  {
+    return;
+  }
+  std::cout << "Current step: " << player->Step << std::endl;
   interactor->Render();
 }
 } // namespace
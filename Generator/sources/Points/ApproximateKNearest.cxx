@@ -0,0 +1,341 @@
+#include <vtkIdList.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNew.h>
+#include <vtkPointSource.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+// Randomized kd-forest: several kd-trees whose split axis is drawn among the
+// axes of largest spread. A query descends the trees one after the other,
+// then keeps exploring the closest unexplored branches of all trees, until
+// Checks points have been compared. Checks is the recall/latency knob: more
+// checks, fewer misses. The first leaf is always compared, so a query
+// compares at least one leaf of points whatever Checks.
+class KdForest
+{
+public:
+  void Build(vtkPoints* points, int numberOfTrees, int leafSize,
+             vtkMinimalStandardRandomSequence* rng);
+
+  // The (about) k closest points of x, closest first
+  void FindClosestNPoints(int k, const double x[3], int checks,
+                          vtkIdList* result) const;
+
+private:
+  struct Node
+  {
+    // Inner node: children Left and Right, split at Value along Axis.
+    // Leaf: Index[Begin] ... Index[End - 1], Axis is -1.
+    std::int32_t Axis;
+    float Value;
+    std::int32_t Left;
+    std::int32_t Right;
+    std::int32_t Begin;
+    std::int32_t End;
+  };
+
+  struct Tree
+  {
+    std::vector<Node> Nodes;
+    std::vector<vtkIdType> Index;
+  };
+
+  std::int32_t Split(Tree& tree, vtkIdType begin, vtkIdType end,
+                     vtkMinimalStandardRandomSequence* rng);
+
+  std::vector<std::array<float, 3>> Points;
+  std::vector<Tree> Trees;
+  int LeafSize = 16;
+  // Stamp of the last query that compared each point, shared by the trees
+  mutable std::vector<std::uint32_t> Visited;
+  mutable std::uint32_t Stamp = 0;
+};
+
+// Fraction of the exact neighbours found
+double Recall(vtkIdList* approximate, const vtkIdType* exact, int k);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: ApproximateKNearest [number of points] [k] [number of trees]
+  vtkIdType numberOfPoints = 200000;
+  int k = 10;
+  int numberOfTrees = 4;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (argc > 2)
+  {
+    k = std::atoi(argv[2]);
+  }
+  if (argc > 3)
+  {
+    numberOfTrees = std::atoi(argv[3]);
+  }
+
+  // A noisy shell, as in NormalEstimation: every point looks for its k
+  // neighbours.
+  vtkNew<vtkPointSource> pointSource;
+  pointSource->SetNumberOfPoints(numberOfPoints);
+  pointSource->SetRadius(1.0);
+  pointSource->SetDistributionToShell();
+  pointSource->Update();
+  auto polydata = pointSource->GetOutput();
+  auto points = polydata->GetPoints();
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkStaticPointLocator> exactLocator;
+  exactLocator->SetDataSet(polydata);
+  timer->StartTimer();
+  exactLocator->BuildLocator();
+  timer->StopTimer();
+  double exactBuildTime = timer->GetElapsedTime();
+
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  KdForest forest;
+  timer->StartTimer();
+  forest.Build(points, numberOfTrees, 16, rng);
+  timer->StopTimer();
+  double forestBuildTime = timer->GetElapsedTime();
+
+  std::cout << numberOfPoints << " points, k = " << k << ", " << numberOfTrees
+            << " trees" << std::endl;
+  std::cout << "build: vtkStaticPointLocator " << exactBuildTime
+            << " s, kd-forest " << forestBuildTime << " s" << std::endl;
+
+  // Exact neighbours of every point
+  vtkNew<vtkIdList> neighbours;
+  std::vector<vtkIdType> exact(numberOfPoints * k);
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    exactLocator->FindClosestNPoints(k, points->GetPoint(i), neighbours);
+    std::copy(neighbours->GetPointer(0),
+              neighbours->GetPointer(0) + neighbours->GetNumberOfIds(),
+              exact.begin() + i * k);
+  }
+  timer->StopTimer();
+  double exactTime = timer->GetElapsedTime();
+  std::cout << "exact: " << exactTime << " s" << std::endl;
+
+  std::cout << "checks  seconds  speedup  recall" << std::endl;
+  for (int checks : {k, 2 * k, 4 * k, 8 * k, 16 * k, 32 * k})
+  {
+    timer->StartTimer();
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+      forest.FindClosestNPoints(k, points->GetPoint(i), checks, neighbours);
+    }
+    timer->StopTimer();
+    double seconds = timer->GetElapsedTime();
+
+    double recall = 0.0;
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+      forest.FindClosestNPoints(k, points->GetPoint(i), checks, neighbours);
+      recall += Recall(neighbours, &exact[i * k], k);
+    }
+    std::cout << checks << "  " << seconds << "  " << exactTime / seconds
+              << "  " << recall / numberOfPoints << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+void KdForest::Build(vtkPoints* points, int numberOfTrees, int leafSize,
+                     vtkMinimalStandardRandomSequence* rng)
+{
+  vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  this->LeafSize = leafSize;
+  this->Points.resize(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    double p[3];
+    points->GetPoint(i, p);
+    this->Points[i] = {static_cast<float>(p[0]), static_cast<float>(p[1]),
+                       static_cast<float>(p[2])};
+  }
+  this->Visited.assign(numberOfPoints, 0);
+  this->Stamp = 0;
+
+  this->Trees.resize(numberOfTrees);
+  for (auto& tree : this->Trees)
+  {
+    tree.Nodes.clear();
+    tree.Index.resize(numberOfPoints);
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+      tree.Index[i] = i;
+    }
+    this->Split(tree, 0, numberOfPoints, rng);
+  }
+}
+
+std::int32_t KdForest::Split(Tree& tree, vtkIdType begin, vtkIdType end,
+                             vtkMinimalStandardRandomSequence* rng)
+{
+  auto nodeIndex = static_cast<std::int32_t>(tree.Nodes.size());
+  tree.Nodes.push_back(Node{-1, 0.0f, -1, -1, static_cast<std::int32_t>(begin),
+                            static_cast<std::int32_t>(end)});
+  if (end - begin <= this->LeafSize)
+  {
+    return nodeIndex;
+  }
+
+  // Mean and spread of a sample of the points
+  double mean[3] = {0.0, 0.0, 0.0};
+  double spread[3] = {0.0, 0.0, 0.0};
+  vtkIdType step = std::max<vtkIdType>(1, (end - begin) / 100);
+  vtkIdType count = 0;
+  for (vtkIdType i = begin; i < end; i += step, ++count)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      mean[j] += this->Points[tree.Index[i]][j];
+    }
+  }
+  for (int j = 0; j < 3; ++j)
+  {
+    mean[j] /= count;
+  }
+  for (vtkIdType i = begin; i < end; i += step)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      double d = this->Points[tree.Index[i]][j] - mean[j];
+      spread[j] += d * d;
+    }
+  }
+
+  // Random axis among the two of largest spread
+  std::array<int, 3> axes = {0, 1, 2};
+  std::sort(axes.begin(), axes.end(),
+            [&](int a, int b) { return spread[a] > spread[b]; });
+  int axis = axes[rng->GetValue() < 0.5 ? 0 : 1];
+  rng->Next();
+  auto value = static_cast<float>(mean[axis]);
+
+  auto middle = std::partition(tree.Index.begin() + begin,
+                               tree.Index.begin() + end, [&](vtkIdType id) {
+                                 return this->Points[id][axis] < value;
+                               });
+  vtkIdType split = middle - tree.Index.begin();
+  if (split == begin || split == end)
+  {
+    split = (begin + end) / 2;
+  }
+
+  std::int32_t left = this->Split(tree, begin, split, rng);
+  std::int32_t right = this->Split(tree, split, end, rng);
+  tree.Nodes[nodeIndex] = Node{axis, value, left, right, -1, -1};
+  return nodeIndex;
+}
+
+void KdForest::FindClosestNPoints(int k, const double x[3], int checks,
+                                  vtkIdList* result) const
+{
+  if (++this->Stamp == 0)
+  {
+    std::fill(this->Visited.begin(), this->Visited.end(), 0);
+    this->Stamp = 1;
+  }
+  const float q[3] = {static_cast<float>(x[0]), static_cast<float>(x[1]),
+                      static_cast<float>(x[2])};
+
+  // k best so far, farthest on top
+  std::priority_queue<std::pair<float, vtkIdType>> best;
+  // Unexplored branches of every tree, closest first:
+  // (distance to the split, tree, node)
+  using Branch = std::pair<float, std::pair<int, std::int32_t>>;
+  std::priority_queue<Branch, std::vector<Branch>, std::greater<Branch>> branches;
+
+  int compared = 0;
+  auto descend = [&](int treeIndex, std::int32_t nodeIndex) {
+    auto const& tree = this->Trees[treeIndex];
+    const Node* node = &tree.Nodes[nodeIndex];
+    while (node->Axis >= 0)
+    {
+      float d = q[node->Axis] - node->Value;
+      std::int32_t nearChild = d < 0.0f ? node->Left : node->Right;
+      std::int32_t farChild = d < 0.0f ? node->Right : node->Left;
+      branches.push({d * d, {treeIndex, farChild}});
+      node = &tree.Nodes[nearChild];
+    }
+    for (std::int32_t i = node->Begin; i < node->End; ++i)
+    {
+      vtkIdType id = tree.Index[i];
+      if (this->Visited[id] == this->Stamp)
+      {
+        continue;
+      }
+      this->Visited[id] = this->Stamp;
+      ++compared;
+      auto const& p = this->Points[id];
+      float dx = p[0] - q[0];
+      float dy = p[1] - q[1];
+      float dz = p[2] - q[2];
+      float distance2 = dx * dx + dy * dy + dz * dz;
+      if (static_cast<int>(best.size()) < k)
+      {
+        best.push({distance2, id});
+      }
+      else if (distance2 < best.top().first)
+      {
+        best.pop();
+        best.push({distance2, id});
+      }
+    }
+  };
+
+  // The first descents count against the checks too
+  for (int t = 0; t < static_cast<int>(this->Trees.size()) &&
+       (t == 0 || compared < checks);
+       ++t)
+  {
+    descend(t, 0);
+  }
+  while (!branches.empty() && compared < checks)
+  {
+    auto branch = branches.top();
+    branches.pop();
+    if (static_cast<int>(best.size()) == k && branch.first > best.top().first)
+    {
+      break;
+    }
+    descend(branch.second.first, branch.second.second);
+  }
+
+  result->SetNumberOfIds(static_cast<vtkIdType>(best.size()));
+  for (auto i = static_cast<vtkIdType>(best.size()) - 1; i >= 0; --i)
+  {
+    result->SetId(i, best.top().second);
+    best.pop();
+  }
+}
+
+double Recall(vtkIdList* approximate, const vtkIdType* exact, int k)
+{
+  int found = 0;
+  for (vtkIdType i = 0; i < approximate->GetNumberOfIds(); ++i)
+  {
+    found += std::find(exact, exact + k, approximate->GetId(i)) != exact + k;
+  }
+  return static_cast<double>(found) / k;
+}
+} // namespace
@@ -0,0 +1,475 @@
+#include <vtkActor.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkNamedColors.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkRenderer.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkStaticPointLocator.h>
+#include <vtkTimerLog.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace {
+// Reorders the points and the cells of a vtkPolyData along a Morton curve,
+// so that points and cells close in space are close in memory. The point
+// and cell data follow, and the connectivity is remapped. The cells stay
+// grouped by kind (verts, lines, polys, strips), as vtkPolyData numbers them.
+class vtkSpatialReorderFilter : public vtkPolyDataAlgorithm
+{
+public:
+  vtkTypeMacro(vtkSpatialReorderFilter, vtkPolyDataAlgorithm);
+  static vtkSpatialReorderFilter* New();
+
+  vtkSetMacro(ReorderPoints, bool);
+  vtkGetMacro(ReorderPoints, bool);
+  vtkBooleanMacro(ReorderPoints, bool);
+
+  vtkSetMacro(ReorderCells, bool);
+  vtkGetMacro(ReorderCells, bool);
+  vtkBooleanMacro(ReorderCells, bool);
+
+protected:
+  vtkSpatialReorderFilter() = default;
+
+  int RequestData(vtkInformation*, vtkInformationVector**,
+                  vtkInformationVector*) override;
+
+  bool ReorderPoints = true;
+  bool ReorderCells = true;
+
+private:
+  vtkSpatialReorderFilter(const vtkSpatialReorderFilter&) = delete;
+  void operator=(const vtkSpatialReorderFilter&) = delete;
+};
+
+// Copies input to output with its points in pointOrder and its cells in
+// cellOrder (new id -> old id). cellOrder must keep every cell among the
+// cells of its kind.
+void Permute(vtkPolyData* input, std::vector<vtkIdType> const& pointOrder,
+             std::vector<vtkIdType> const& cellOrder, vtkPolyData* output);
+
+// First cell id of the verts, lines, polys and strips, then the number of
+// cells
+std::array<vtkIdType, 5> CellKindRanges(vtkPolyData* polydata);
+
+// The mesh in file order of a scan or a merge: points and cells shuffled
+vtkSmartPointer<vtkPolyData> Shuffle(vtkPolyData* input,
+                                     vtkMinimalStandardRandomSequence* rng);
+
+// Times the cache-bound steps that follow a reader, prints a CSV row
+void TimePipeline(std::string const& name, vtkPolyData* polydata,
+                  vtkRenderWindow* renderWindow, vtkPolyDataMapper* mapper);
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  // Usage: SpatialReorder [number of points]
+  vtkIdType numberOfPoints = 250000;
+  if (argc > 1)
+  {
+    numberOfPoints = std::atoll(argv[1]);
+  }
+  if (numberOfPoints > 1024 * 1024)
+  {
+    std::cout << "vtkSphereSource makes at most " << 1024 * 1024
+              << " points" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkNew<vtkNamedColors> colors;
+
+  // A sphere of resolution r x r has about r * r points.
+  auto resolution = static_cast<int>(std::sqrt(static_cast<double>(numberOfPoints)));
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(std::max(3, resolution));
+  sphere->SetPhiResolution(std::max(3, resolution));
+  sphere->Update();
+
+  vtkNew<vtkMinimalStandardRandomSequence> rng;
+  rng->SetSeed(8775070);
+  auto shuffled = Shuffle(sphere->GetOutput(), rng);
+
+  vtkNew<vtkTimerLog> timer;
+  vtkNew<vtkSpatialReorderFilter> reorder;
+  reorder->SetInputData(shuffled);
+  timer->StartTimer();
+  reorder->Update();
+  timer->StopTimer();
+  auto reordered = reorder->GetOutput();
+  std::cout << shuffled->GetNumberOfPoints() << " points, "
+            << shuffled->GetNumberOfCells() << " cells, reordered in "
+            << timer->GetElapsedTime() << " s" << std::endl;
+
+  vtkNew<vtkPolyDataMapper> mapper;
+  vtkNew<vtkActor> actor;
+  actor->SetMapper(mapper);
+  vtkNew<vtkRenderer> renderer;
+  renderer->AddActor(actor);
+  renderer->SetBackground(colors->GetColor3d("SlateGray").GetData());
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->AddRenderer(renderer);
+  renderWindow->SetSize(640, 480);
+  renderWindow->SetWindowName("SpatialReorder");
+
+  std::cout << "mesh,locator_build_s,radius_queries_s,one_ring_s,"
+               "one_ring_visits,normals_s,first_render_s,render_s"
+            << std::endl;
+  TimePipeline("source", sphere->GetOutput(), renderWindow, mapper);
+  TimePipeline("shuffled", shuffled, renderWindow, mapper);
+  TimePipeline("reordered", reordered, renderWindow, mapper);
+
+  // Color the reordered points by their index: the colors follow the curve.
+  vtkNew<vtkFloatArray> index;
+  index->SetName("PointIndex");
+  index->SetNumberOfValues(reordered->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < reordered->GetNumberOfPoints(); ++i)
+  {
+    index->SetValue(i, static_cast<float>(i));
+  }
+  vtkNew<vtkPolyData> display;
+  display->ShallowCopy(reordered);
+  display->GetPointData()->SetScalars(index);
+  mapper->SetInputData(display);
+  mapper->SetScalarRange(0, reordered->GetNumberOfPoints());
+  renderer->ResetCamera();
+
+  vtkNew<vtkRenderWindowInteractor> renderWindowInteractor;
+  renderWindowInteractor->SetRenderWindow(renderWindow);
+  renderWindow->Render();
+  renderWindowInteractor->Start();
+
+  return EXIT_SUCCESS;
+}
+
+namespace {
+vtkStandardNewMacro(vtkSpatialReorderFilter);
+
+// Spreads the 21 low bits of v over 63 bits, two zeros between each bit.
+std::uint64_t SpreadBits(std::uint64_t v)
+{
+  v &= 0x1FFFFF;
+  v = (v | (v << 32)) & 0x001F00000000FFFFull;
+  v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+  v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+  v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+  v = (v | (v << 2)) & 0x1249249249249249ull;
+  return v;
+}
+
+// Sorts order[begin, end) by the Morton codes of positions[order[i]]
+void SortAlongCurve(std::vector<std::array<double, 3>> const& positions,
+                    const double bounds[6], vtkIdType begin, vtkIdType end,
+                    std::vector<vtkIdType>& order)
+{
+  std::vector<std::uint64_t> codes(positions.size());
+  vtkSMPTools::For(begin, end, [&](vtkIdType first, vtkIdType last) {
+    for (vtkIdType i = first; i < last; ++i)
+    {
+      auto const& p = positions[order[i]];
+      std::uint64_t code = 0;
+      for (int j = 0; j < 3; ++j)
+      {
+        double length = bounds[2 * j + 1] - bounds[2 * j];
+        double t = length > 0.0 ? (p[j] - bounds[2 * j]) / length : 0.0;
+        auto cell = static_cast<std::uint64_t>(
+            std::min(2097151.0, std::max(0.0, t * 2097152.0)));
+        code |= SpreadBits(cell) << j;
+      }
+      codes[order[i]] = code;
+    }
+  });
+  vtkSMPTools::Sort(order.begin() + begin, order.begin() + end,
+                    [&](vtkIdType a, vtkIdType b) { return codes[a] < codes[b]; });
+}
+
+int vtkSpatialReorderFilter::RequestData(vtkInformation*,
+                                         vtkInformationVector** inputVector,
+                                         vtkInformationVector* outputVector)
+{
+  auto input = vtkPolyData::GetData(inputVector[0]);
+  auto output = vtkPolyData::GetData(outputVector);
+  vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  vtkIdType numberOfCells = input->GetNumberOfCells();
+  double bounds[6];
+  input->GetBounds(bounds);
+
+  std::vector<vtkIdType> pointOrder(numberOfPoints);
+  std::iota(pointOrder.begin(), pointOrder.end(), 0);
+  if (this->ReorderPoints)
+  {
+    std::vector<std::array<double, 3>> positions(numberOfPoints);
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+      input->GetPoint(i, positions[i].data());
+    }
+    SortAlongCurve(positions, bounds, 0, numberOfPoints, pointOrder);
+  }
+
+  std::vector<vtkIdType> cellOrder(numberOfCells);
+  std::iota(cellOrder.begin(), cellOrder.end(), 0);
+  if (this->ReorderCells)
+  {
+    // Cells by their centroid, within their kind
+    std::vector<std::array<double, 3>> centroids(numberOfCells);
+    vtkIdType npts;
+    const vtkIdType* pts;
+    for (vtkIdType c = 0; c < numberOfCells; ++c)
+    {
+      input->GetCellPoints(c, npts, pts);
+      centroids[c] = {0.0, 0.0, 0.0};
+      for (vtkIdType k = 0; k < npts; ++k)
+      {
+        double p[3];
+        input->GetPoint(pts[k], p);
+        for (int j = 0; j < 3; ++j)
+        {
+          centroids[c][j] += p[j] / npts;
+        }
+      }
+    }
+    auto ranges = CellKindRanges(input);
+    for (int kind = 0; kind < 4; ++kind)
+    {
+      SortAlongCurve(centroids, bounds, ranges[kind], ranges[kind + 1], cellOrder);
+    }
+  }
+
+  Permute(input, pointOrder, cellOrder, output);
+  return 1;
+}
+
+std::array<vtkIdType, 5> CellKindRanges(vtkPolyData* polydata)
+{
+  std::array<vtkIdType, 5> ranges;
+  ranges[0] = 0;
+  ranges[1] = ranges[0] + polydata->GetNumberOfVerts();
+  ranges[2] = ranges[1] + polydata->GetNumberOfLines();
+  ranges[3] = ranges[2] + polydata->GetNumberOfPolys();
+  ranges[4] = ranges[3] + polydata->GetNumberOfStrips();
+  return ranges;
+}
+
+vtkSmartPointer<vtkIdList> ToIdList(std::vector<vtkIdType> const& ids)
+{
+  auto list = vtkSmartPointer<vtkIdList>::New();
+  list->SetNumberOfIds(static_cast<vtkIdType>(ids.size()));
+  std::copy(ids.begin(), ids.end(), list->GetPointer(0));
+  return list;
+}
+
+void Permute(vtkPolyData* input, std::vector<vtkIdType> const& pointOrder,
+             std::vector<vtkIdType> const& cellOrder, vtkPolyData* output)
+{
+  auto numberOfPoints = static_cast<vtkIdType>(pointOrder.size());
+  auto numberOfCells = static_cast<vtkIdType>(cellOrder.size());
+  auto oldPointIds = ToIdList(pointOrder);
+  auto oldCellIds = ToIdList(cellOrder);
+  std::vector<vtkIdType> identity(std::max(numberOfPoints, numberOfCells));
+  std::iota(identity.begin(), identity.end(), 0);
+  auto newPointIds = ToIdList(
+      std::vector<vtkIdType>(identity.begin(), identity.begin() + numberOfPoints));
+  auto newCellIds = ToIdList(
+      std::vector<vtkIdType>(identity.begin(), identity.begin() + numberOfCells));
+
+  output->Initialize();
+  if (input->GetPoints())
+  {
+    vtkNew<vtkPoints> points;
+    points->SetDataType(input->GetPoints()->GetDataType());
+    input->GetPoints()->GetPoints(oldPointIds, points);
+    output->SetPoints(points);
+  }
+  output->GetPointData()->CopyAllocate(input->GetPointData(), numberOfPoints);
+  output->GetPointData()->CopyData(input->GetPointData(), oldPointIds,
+                                   newPointIds);
+
+  // Connectivity, with the new point ids
+  std::vector<vtkIdType> newPointId(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    newPointId[pointOrder[i]] = i;
+  }
+  auto ranges = CellKindRanges(input);
+  vtkCellArray* inputCells[4] = {input->GetVerts(), input->GetLines(),
+                                 input->GetPolys(), input->GetStrips()};
+  std::vector<vtkIdType> cell;
+  for (int kind = 0; kind < 4; ++kind)
+  {
+    if (ranges[kind + 1] == ranges[kind])
+    {
+      continue;
+    }
+    vtkNew<vtkCellArray> cells;
+    cells->AllocateExact(ranges[kind + 1] - ranges[kind],
+                         inputCells[kind]->GetNumberOfConnectivityIds());
+    for (vtkIdType c = ranges[kind]; c < ranges[kind + 1]; ++c)
+    {
+      vtkIdType npts;
+      const vtkIdType* pts;
+      inputCells[kind]->GetCellAtId(cellOrder[c] - ranges[kind], npts, pts);
+      cell.resize(npts);
+      for (vtkIdType k = 0; k < npts; ++k)
+      {
+        cell[k] = newPointId[pts[k]];
+      }
+      cells->InsertNextCell(npts, cell.data());
+    }
+    switch (kind)
+    {
+      case 0:
+        output->SetVerts(cells);
+        break;
+      case 1:
+        output->SetLines(cells);
+        break;
+      case 2:
+        output->SetPolys(cells);
+        break;
+      default:
+        output->SetStrips(cells);
+        break;
+    }
+  }
+  output->GetCellData()->CopyAllocate(input->GetCellData(), numberOfCells);
+  output->GetCellData()->CopyData(input->GetCellData(), oldCellIds, newCellIds);
+  output->GetFieldData()->PassData(input->GetFieldData());
+}
+
+// Fisher-Yates shuffle of order[begin, end)
+void ShuffleRange(vtkIdType begin, vtkIdType end,
+                  vtkMinimalStandardRandomSequence* rng,
+                  std::vector<vtkIdType>& order)
+{
+  for (vtkIdType i = end - 1; i > begin; --i)
+  {
+    auto j = begin +
+        std::min(i - begin,
+                 static_cast<vtkIdType>(rng->GetValue() * (i - begin + 1)));
+    rng->Next();
+    std::swap(order[i], order[j]);
+  }
+}
+
+vtkSmartPointer<vtkPolyData> Shuffle(vtkPolyData* input,
+                                     vtkMinimalStandardRandomSequence* rng)
+{
+  std::vector<vtkIdType> pointOrder(input->GetNumberOfPoints());
+  std::iota(pointOrder.begin(), pointOrder.end(), 0);
+  ShuffleRange(0, input->GetNumberOfPoints(), rng, pointOrder);
+
+  std::vector<vtkIdType> cellOrder(input->GetNumberOfCells());
+  std::iota(cellOrder.begin(), cellOrder.end(), 0);
+  auto ranges = CellKindRanges(input);
+  for (int kind = 0; kind < 4; ++kind)
+  {
+    ShuffleRange(ranges[kind], ranges[kind + 1], rng, cellOrder);
+  }
+
+  auto output = vtkSmartPointer<vtkPolyData>::New();
+  Permute(input, pointOrder, cellOrder, output);
+  return output;
+}
+
+void TimePipeline(std::string const& name, vtkPolyData* polydata,
+                  vtkRenderWindow* renderWindow, vtkPolyDataMapper* mapper)
+{
+  vtkNew<vtkTimerLog> timer;
+  vtkIdType numberOfPoints = polydata->GetNumberOfPoints();
+
+  // Locator build, then a radius query around every point in index order.
+  // The N points cover a sphere of area pi, about 8 are within the radius.
+  vtkNew<vtkStaticPointLocator> locator;
+  locator->SetDataSet(polydata);
+  timer->StartTimer();
+  locator->BuildLocator();
+  timer->StopTimer();
+  double locatorTime = timer->GetElapsedTime();
+
+  double radius = std::sqrt(8.0 / numberOfPoints);
+  vtkNew<vtkIdList> neighbours;
+  timer->StartTimer();
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    locator->FindPointsWithinRadius(radius, polydata->GetPoint(i), neighbours);
+  }
+  timer->StopTimer();
+  double radiusTime = timer->GetElapsedTime();
+
+  // The points of the cells around every point, as smoothing or curvature
+  // filters visit them. The count of visits with x > 0 is printed, so that
+  // the loop is not optimized away; it is the same for every order.
+  timer->StartTimer();
+  polydata->BuildLinks();
+  vtkIdType visited = 0;
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    vtkIdType ncells;
+    vtkIdType* cells;
+    polydata->GetPointCells(i, ncells, cells);
+    for (vtkIdType c = 0; c < ncells; ++c)
+    {
+      vtkIdType npts;
+      const vtkIdType* pts;
+      polydata->GetCellPoints(cells[c], npts, pts);
+      for (vtkIdType k = 0; k < npts; ++k)
+      {
+        visited += polydata->GetPoint(pts[k])[0] > 0.0;
+      }
+    }
+  }
+  timer->StopTimer();
+  double oneRingTime = timer->GetElapsedTime();
+
+  vtkNew<vtkPolyDataNormals> normals;
+  normals->SetInputData(polydata);
+  timer->StartTimer();
+  normals->Update();
+  timer->StopTimer();
+  double normalsTime = timer->GetElapsedTime();
+
+  // The first render uploads the mesh, the next ones only draw it
+  mapper->SetInputData(polydata);
+  renderWindow->GetRenderers()->GetFirstRenderer()->ResetCamera();
+  timer->StartTimer();
+  renderWindow->Render();
+  timer->StopTimer();
+  double firstRenderTime = timer->GetElapsedTime();
+  const int numberOfFrames = 10;
+  timer->StartTimer();
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    renderWindow->Render();
+  }
+  timer->StopTimer();
+  double renderTime = timer->GetElapsedTime() / numberOfFrames;
+
+  std::cout << name << "," << locatorTime << "," << radiusTime << ","
+            << oneRingTime << "," << visited << "," << normalsTime << ","
+            << firstRenderTime << "," << renderTime << std::endl;
+}
+} // namespace
@@ -0,0 +1,57 @@
+// Compare sequential and streaming WebAssembly compilation of an example
+// served by serve_ranges.py, for every content encoding.
+//
+// Usage: node streaming_report.js <base_url> <example_name>
+//
+// "overlap_ms" is the time saved by compiling while the module downloads.
+
+const { performance } = require('perf_hooks');
+
+const ENCODINGS = ['identity', 'gzip', 'br'];
+
+function elapsed(from) {
+  return Math.round((performance.now() - from) * 1000) / 1000;
+}
+
+function fetchWasm(url, encoding) {
+  return fetch(url, { headers: { 'Accept-Encoding': encoding }, cache: 'no-store' });
+}
+
+async function measure(url, encoding) {
+  const result = { encoding: encoding };
+
+  let start = performance.now();
+  const response = await fetchWasm(url, encoding);
+  result.transfer_bytes = Number(response.headers.get('content-length'));
+  result.content_encoding = response.headers.get('content-encoding') || 'identity';
+  const bytes = await response.arrayBuffer();
+  result.download_ms = elapsed(start);
+  start = performance.now();
+  await WebAssembly.compile(bytes);
+  result.compile_ms = elapsed(start);
+  result.sequential_ms = result.download_ms + result.compile_ms;
+
+  start = performance.now();
+  await WebAssembly.compileStreaming(fetchWasm(url, encoding));
+  result.streaming_ms = elapsed(start);
+  result.overlap_ms = Math.round((result.sequential_ms - result.streaming_ms) * 1000) / 1000;
+  return result;
+}
+
+async function main() {
+  if (process.argv.length !== 4) {
+    console.error('Usage: node streaming_report.js <base_url> <example_name>');
+    process.exit(1);
+  }
+  const url = new URL(process.argv[3] + '.wasm', process.argv[2].replace(/\/?$/, '/')).href;
+  const report = { example: process.argv[3], results: [] };
+  for (const encoding of ENCODINGS) {
+    report.results.push(await measure(url, encoding));
+  }
+  process.stdout.write(JSON.stringify(report, null, 2) + '\n');
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,10 @@
+// Force-included (-include) when an example is built as a side module of the
+// shared VTK runtime (RUNTIME=SHARED): the runtime main() looks the example
+// entry point up by name, so main() gets C linkage under another name.
+#ifndef vtk_example_entry_h
+#define vtk_example_entry_h
+
+extern "C" int vtk_example_main(int, char**);
+#define main vtk_example_main
+
+#endif
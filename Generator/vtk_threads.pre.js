@@ -0,0 +1,18 @@
+// Included with --pre-js by threaded (THREADING=PTHREADS) builds.
+// Sizes the pthread pool to the host and selects the vtkSMPTools backend.
+
+var vtkThreadPoolSize = (function () {
+  if (typeof navigator !== 'undefined' && navigator.hardwareConcurrency) {
+    return navigator.hardwareConcurrency;
+  }
+  if (typeof process === 'object' && typeof require === 'function') {
+    return require('os').cpus().length;
+  }
+  return 4;
+})();
+
+Module['preRun'] = [].concat(Module['preRun'] || [], function () {
+  // vtkSMPTools reads these through getenv() when it is first used.
+  ENV['VTK_SMP_BACKEND_IN_USE'] = 'STDThread';
+  ENV['VTK_SMP_MAX_THREADS'] = String(vtkThreadPoolSize);
+});